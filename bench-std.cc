@@ -0,0 +1,463 @@
+// std::string rows for the benchmarks in bench.c, with the same input text,
+// sizes, timing loop and output format, so the results can be joined on
+// "bench" and "size".
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define MIN_TIME 0.02
+#define CHUNK "0123456789abcdef"
+#define CHUNK_LEN 16
+#define QUADRATIC (32 * 1024)
+#define FORMATTED (2 * 1024 * 1024)
+#define MISSING "ponmlkjz"
+
+struct Ctx {
+	long size;
+	std::string text, padded, a, b;
+	std::vector<std::string> parts;
+	std::unordered_map<std::string, long> map; // filled by the first run
+	std::unordered_set<std::string> pool;      // likewise
+	volatile long sink;
+};
+
+struct Bench {
+	const char *name;
+	long maxSize;
+	void (*run)(Ctx &c);
+};
+
+static double now()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t chunkLen(const Ctx &c, long pos)
+{
+	return (c.size - pos < CHUNK_LEN) ? c.size - pos : CHUNK_LEN;
+}
+
+static void initLen(Ctx &c)
+{
+	std::string s(c.text.data(), c.size);
+	c.sink += s.size();
+}
+
+static void initCopy(Ctx &c)
+{
+	std::string s(c.a);
+	c.sink += s.size();
+}
+
+static void copy(Ctx &c)
+{
+	c.b = c.a;
+}
+
+static void reserve(Ctx &c)
+{
+	std::string s;
+	s.reserve(c.size);
+	c.sink += s.capacity();
+}
+
+static void resize(Ctx &c)
+{
+	std::string s;
+	s.resize(c.size);
+	c.sink += s.size();
+}
+
+static void compact(Ctx &c)
+{
+	c.a.reserve(c.size * 2);
+	c.a.shrink_to_fit();
+}
+
+static void swap(Ctx &c)
+{
+	c.a.swap(c.b);
+	c.a.swap(c.b);
+}
+
+static void assignLen(Ctx &c)
+{
+	c.a.assign(c.text.data(), c.size);
+}
+
+static void appendLen(Ctx &c)
+{
+	std::string s;
+	for (long i = 0; i < c.size; i += CHUNK_LEN)
+		s.append(c.text.data() + i, chunkLen(c, i));
+}
+
+static void appendCh(Ctx &c)
+{
+	std::string s;
+	for (long i = 0; i < c.size; i++)
+		s.push_back(c.text[i]);
+}
+
+static void appendFmt(Ctx &c)
+{
+	std::string s;
+	for (int i = 0; s.size() < (size_t)c.size; i++) {
+		s += std::to_string(i);
+		s += ',';
+	}
+}
+
+static void appendMany(Ctx &c)
+{
+	std::string s;
+	while (s.size() < (size_t)c.size) {
+		for (int i = 0; i < 4; i++)
+			s.append(CHUNK, CHUNK_LEN);
+	}
+}
+
+static void concat(Ctx &c)
+{
+	c.a = c.text;
+	c.a += ',';
+	c.a += c.text;
+}
+
+static void prependLen(Ctx &c)
+{
+	c.a.clear();
+	while (c.a.size() < (size_t)c.size)
+		c.a.insert(0, CHUNK, CHUNK_LEN);
+}
+
+static void insertLen(Ctx &c)
+{
+	c.a.clear();
+	while (c.a.size() < (size_t)c.size)
+		c.a.insert(c.a.size() / 2, CHUNK, CHUNK_LEN);
+}
+
+static void erase(Ctx &c)
+{
+	c.a.assign(c.text.data(), c.size);
+	while (!c.a.empty())
+		c.a.erase(0, CHUNK_LEN);
+}
+
+static void overwriteLen(Ctx &c)
+{
+	for (size_t i = 0; i + CHUNK_LEN <= c.a.size(); i += 64)
+		c.a.replace(i, CHUNK_LEN, CHUNK, CHUNK_LEN);
+}
+
+static void replaceAll(Ctx &c, const std::string &needle, const std::string &repl)
+{
+	c.a.assign(c.text.data(), c.size);
+	std::string out;
+	size_t pos = 0, m;
+	while ((m = c.a.find(needle, pos)) != std::string::npos) {
+		out.append(c.a, pos, m - pos);
+		out += repl;
+		pos = m + needle.size();
+	}
+	out.append(c.a, pos, std::string::npos);
+	c.a.swap(out);
+}
+
+static void replaceShrink(Ctx &c)
+{
+	replaceAll(c, "ab", "x");
+}
+
+static void replaceGrow(Ctx &c)
+{
+	replaceAll(c, "ab", "xyz");
+}
+
+static void replaceLen(Ctx &c)
+{
+	replaceAll(c, "ab", "xy");
+}
+
+static void strip(Ctx &c)
+{
+	c.a = c.padded;
+	const char *ws = " \t\n\r\v\f";
+	c.a.erase(0, c.a.find_first_not_of(ws));
+	c.a.erase(c.a.find_last_not_of(ws) + 1);
+}
+
+static void compare(Ctx &c)
+{
+	c.sink += c.a.compare(c.b);
+}
+
+static void equal(Ctx &c)
+{
+	c.sink += c.a == c.b;
+}
+
+static void toUpper(Ctx &c)
+{
+	std::transform(c.a.begin(), c.a.end(), c.a.begin(),
+		[](unsigned char ch) { return (char)std::toupper(ch); });
+}
+
+static void toLower(Ctx &c)
+{
+	std::transform(c.a.begin(), c.a.end(), c.a.begin(),
+		[](unsigned char ch) { return (char)std::tolower(ch); });
+}
+
+static void firstIndexOf(Ctx &c)
+{
+	c.sink += c.a.find(MISSING) != std::string::npos;
+}
+
+static void firstIndexOfCh(Ctx &c)
+{
+	c.sink += c.a.find('z') != std::string::npos;
+}
+
+static void lastIndexOf(Ctx &c)
+{
+	c.sink += c.a.rfind(MISSING) != std::string::npos;
+}
+
+static void lastIndexOfCh(Ctx &c)
+{
+	c.sink += c.a.rfind('z') != std::string::npos;
+}
+
+static void startsWith(Ctx &c)
+{
+	c.sink += c.a.compare(0, 8, "abcdefgh") == 0;
+}
+
+static void endsWith(Ctx &c)
+{
+	c.sink += c.a.size() >= 8 && c.a.compare(c.a.size() - 8, 8, "abcdefgh") == 0;
+}
+
+static void rightJustify(Ctx &c)
+{
+	c.a.assign(c.text.data(), c.size);
+	c.a.insert(0, c.size, ' ');
+}
+
+static void leftJustify(Ctx &c)
+{
+	c.a.assign(c.text.data(), c.size);
+	c.a.append(c.size, ' ');
+}
+
+static void splitCh(Ctx &c)
+{
+	size_t pos = 0, m;
+	while ((m = c.text.find(',', pos)) != std::string::npos) {
+		c.sink += m - pos;
+		pos = m + 1;
+	}
+	c.sink += c.text.size() - pos;
+}
+
+static void join(Ctx &c)
+{
+	c.a.clear();
+	for (size_t i = 0; i < c.parts.size(); i++) {
+		if (i > 0)
+			c.a += ',';
+		c.a += c.parts[i];
+	}
+}
+
+static void appendViews(Ctx &c)
+{
+	std::string s;
+	for (const std::string &part : c.parts)
+		s += part;
+	c.sink += s.size();
+}
+
+static void mapSet(Ctx &c)
+{
+	std::unordered_map<std::string, long> m;
+	for (size_t i = 0; i < c.parts.size(); i++)
+		m[c.parts[i]] = i;
+	c.sink += m.size();
+}
+
+static void mapGet(Ctx &c)
+{
+	if (c.map.empty()) {
+		for (size_t i = 0; i < c.parts.size(); i++)
+			c.map[c.parts[i]] = i;
+	}
+	for (const std::string &part : c.parts)
+		c.sink += c.map.find(part) != c.map.end();
+}
+
+static void intern(Ctx &c)
+{
+	std::unordered_set<std::string> p;
+	for (const std::string &part : c.parts)
+		c.sink += p.insert(part).first->size();
+}
+
+static void internHit(Ctx &c)
+{
+	for (const std::string &part : c.parts)
+		c.sink += c.pool.insert(part).first->size();
+}
+
+static void listAppend(Ctx &c)
+{
+	std::vector<std::string> l;
+	for (const std::string &part : c.parts)
+		l.push_back(part);
+	c.sink += l.size();
+}
+
+static void listSort(Ctx &c)
+{
+	std::vector<std::string> l(c.parts);
+	std::sort(l.begin(), l.end());
+	c.sink += l[0].size();
+}
+
+static void hash(Ctx &c)
+{
+	c.sink += (long)std::hash<std::string>()(c.a);
+}
+
+static const Bench benches[] = {
+	{ "init_len", 0, initLen },
+	{ "init_copy", 0, initCopy },
+	{ "copy", 0, copy },
+	{ "reserve", 0, reserve },
+	{ "resize", 0, resize },
+	{ "compact", 0, compact },
+	{ "swap", 0, swap },
+	{ "assign_len", 0, assignLen },
+	{ "append_len", 0, appendLen },
+	{ "append_ch", 0, appendCh },
+	{ "append_fmt", FORMATTED, appendFmt },
+	{ "append_int", FORMATTED, appendFmt },
+	{ "append_many", 0, appendMany },
+	{ "concat", 0, concat },
+	{ "prepend_len", QUADRATIC, prependLen },
+	{ "insert_len", QUADRATIC, insertLen },
+	{ "erase", QUADRATIC, erase },
+	{ "overwrite_len", 0, overwriteLen },
+	{ "replace_shrink", 0, replaceShrink },
+	{ "replace_grow", 0, replaceGrow },
+	{ "replace_len", 0, replaceLen },
+	{ "strip", 0, strip },
+	{ "compare", 0, compare },
+	{ "equal", 0, equal },
+	{ "to_upper", 0, toUpper },
+	{ "to_lower", 0, toLower },
+	{ "first_index_of", 0, firstIndexOf },
+	{ "first_index_of_ch", 0, firstIndexOfCh },
+	{ "last_index_of", 0, lastIndexOf },
+	{ "last_index_of_ch", 0, lastIndexOfCh },
+	{ "starts_with", 0, startsWith },
+	{ "ends_with", 0, endsWith },
+	{ "left_justify", 0, leftJustify },
+	{ "right_justify", 0, rightJustify },
+	{ "split_ch", 0, splitCh },
+	{ "join", 0, join },
+	{ "append_views", 0, appendViews },
+	{ "rope_append_len", 0, appendLen },
+	{ "rope_insert_len", QUADRATIC, insertLen },
+	{ "gap_insert_len", QUADRATIC, insertLen },
+	{ "map_set", 0, mapSet },
+	{ "map_get", 0, mapGet },
+	{ "intern", 0, intern },
+	{ "intern_hit", 0, internHit },
+	{ "list_append", 0, listAppend },
+	{ "list_sort", 0, listSort },
+	{ "hash", 0, hash },
+};
+
+static const long sizes[] = {
+	8, 64, 512, 4096, 32768, 262144, 2097152, 16777216, 67108864
+};
+
+// Same generator as bench.c.
+static void ctxInit(Ctx &c, long size)
+{
+	unsigned int seed = 12345;
+	const long edge = (size < 8) ? size : 8;
+	c.size = size;
+	c.text.resize(size);
+	for (long i = 0; i < size; i++) {
+		seed = seed * 1103515245u + 12345u;
+		const unsigned int r = seed >> 16;
+		c.text[i] = (r % 32 == 0) ? ',' : 'a' + r % 16;
+	}
+	c.text.replace(0, edge, "abcdefgh", edge);
+	c.text.replace(size - edge, edge, "abcdefgh", edge);
+	c.padded = std::string(16, ' ') + c.text + std::string(16, ' ');
+	c.a = c.text;
+	c.b = c.text;
+	c.parts.clear();
+	size_t pos = 0, m;
+	while ((m = c.text.find(',', pos)) != std::string::npos) {
+		c.parts.push_back(c.text.substr(pos, m - pos));
+		pos = m + 1;
+	}
+	c.parts.push_back(c.text.substr(pos));
+	c.sink = 0;
+}
+
+static void runBench(const Bench &bench, long size)
+{
+	Ctx c;
+	ctxInit(c, size);
+	bench.run(c);
+
+	long iters = 1;
+	double elapsed;
+	for (;;) {
+		const double start = now();
+		for (long i = 0; i < iters; i++)
+			bench.run(c);
+		elapsed = now() - start;
+		if (elapsed >= MIN_TIME)
+			break;
+		iters *= (elapsed > MIN_TIME / 64) ? 2 : 16;
+	}
+	const double ns = elapsed * 1e9 / iters;
+	printf("{\"bench\":\"%s\",\"impl\":\"std\",\"size\":%ld,\"iters\":%ld,"
+		"\"ns_per_op\":%.1f,\"mb_per_s\":%.1f}\n",
+		bench.name, size, iters, ns, size / ns * 1e3);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	const long maxSize = (argc > 1) ? atol(argv[1]) : LONG_MAX;
+	const char *filter = (argc > 2) ? argv[2] : NULL;
+
+	for (const Bench &bench : benches) {
+		if (filter && !strstr(bench.name, filter))
+			continue;
+		for (long size : sizes) {
+			if (size > maxSize || (bench.maxSize && size > bench.maxSize))
+				break;
+			runBench(bench, size);
+		}
+	}
+	return 0;
+}
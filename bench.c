@@ -0,0 +1,1614 @@
+#define _POSIX_C_SOURCE 200809L
+#include "xstr.h"
+#include "xstrgap.h"
+#include "xstrintern.h"
+#include "xstrio.h"
+#include "xstrlist.h"
+#include "xstrmap.h"
+#include "xstrrope.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+// Prints one JSON object per line for every benchmark and size:
+//   {"bench":"append_len","impl":"xstr","size":4096,"iters":...,
+//    "ns_per_op":...,"mb_per_s":...}
+// Usage: bench [maxSize [filter]], where filter is a substring of the
+// benchmark names to run. Benchmarks sharing a name do the same work, so
+// the "libc" rows are the baseline for the "xstr" rows. Operations that
+// mutate their input restore it inside the timed loop, the same way for
+// every implementation.
+
+#define MIN_TIME 0.02
+#define CHUNK "0123456789abcdef"
+#define CHUNK_LEN 16
+#define QUADRATIC (32 * 1024)
+#define FORMATTED (2 * 1024 * 1024)
+#define MISSING "ponmlkjz"
+// spread over the whole range, so every digit count shows up
+#define WIDE(i) ((unsigned long long)(i) * 0x9e3779b97f4a7c15ull >> ((i) % 64))
+
+typedef struct {
+	char *p;
+	size_t len, cap;
+} Buf;
+
+typedef struct {
+	xStrSize size;
+	char *text;   // size bytes of a-p with some commas, NUL-terminated
+	char *padded; // text with 16 spaces on each side
+	xStr a, b;
+	xStrView *views;
+	xStr *strs;
+	xStrSize nparts;
+	xStrArena arena;
+	xStrMap map;   // the fields, filled by the first, untimed run
+	xStrPool pool; // likewise
+	char path[256]; // text in a temp file, written on first use
+	Buf buf;
+	volatile long sink;
+} Ctx;
+
+typedef struct {
+	const char *name, *impl;
+	xStrSize maxSize;
+	void (*run)(Ctx *c);
+} Bench;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bufReserve(Buf *b, size_t n)
+{
+	if (n + 1 <= b->cap)
+		return;
+	size_t ncap = b->cap ? b->cap : 16;
+	while (ncap < n + 1)
+		ncap *= 2;
+	char *p = realloc(b->p, ncap);
+	if (!p) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	b->p = p;
+	b->cap = ncap;
+}
+
+static void bufAppend(Buf *b, const char *s, size_t n)
+{
+	bufReserve(b, b->len + n);
+	memcpy(b->p + b->len, s, n);
+	b->len += n;
+	b->p[b->len] = '\0';
+}
+
+static void bufFree(Buf *b)
+{
+	free(b->p);
+	b->p = NULL;
+	b->len = b->cap = 0;
+}
+
+static const char *ctxFile(Ctx *c)
+{
+	if (c->path[0])
+		return c->path;
+	const char *dir = getenv("TMPDIR");
+	snprintf(c->path, sizeof(c->path), "%s/xstr-bench-XXXXXX", (dir && *dir) ? dir : "/tmp");
+	const int fd = mkstemp(c->path);
+	if (fd < 0 || write(fd, c->text, c->size) != (ssize_t)c->size) {
+		fprintf(stderr, "can't write %s\n", c->path);
+		exit(1);
+	}
+	close(fd);
+	return c->path;
+}
+
+static xStrSize chunkLen(const Ctx *c, xStrSize pos)
+{
+	return (c->size - pos < CHUNK_LEN) ? c->size - pos : CHUNK_LEN;
+}
+
+// Construction
+
+static void xInit(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, c->text);
+	c->sink += s.len;
+	xStrCleanup(&s);
+}
+
+static void xInitLen(Ctx *c)
+{
+	xStr s;
+	xStrInitLen(&s, c->text, c->size);
+	c->sink += s.len;
+	xStrCleanup(&s);
+}
+
+static void cInitLen(Ctx *c)
+{
+	char *p = malloc(c->size + 1);
+	memcpy(p, c->text, c->size + 1);
+	c->sink += p[0];
+	free(p);
+}
+
+static void xInitAlloc(Ctx *c)
+{
+	xStr s;
+	xStrInitAlloc(&s, c->text, xStrArenaAllocator(&c->arena));
+	c->sink += s.len;
+	xStrCleanup(&s);
+	xStrArenaReset(&c->arena);
+}
+
+static void xInitLenAlloc(Ctx *c)
+{
+	xStr s;
+	xStrInitLenAlloc(&s, c->text, c->size, xStrArenaAllocator(&c->arena));
+	c->sink += s.len;
+	xStrCleanup(&s);
+	xStrArenaReset(&c->arena);
+}
+
+static void xNew(Ctx *c)
+{
+	xStr *s = xStrNew(c->text);
+	c->sink += s->len;
+	xStrDelete(s);
+}
+
+static void xNewLen(Ctx *c)
+{
+	xStr *s = xStrNewLen(c->text, c->size);
+	c->sink += s->len;
+	xStrDelete(s);
+}
+
+// Copies share the buffer; the libc rows copy the bytes as usual
+
+static void xInitCopy(Ctx *c)
+{
+	xStr s;
+	xStrInitCopy(&s, &c->a);
+	c->sink += s.len;
+	xStrCleanup(&s);
+}
+
+static void xCopy(Ctx *c)
+{
+	xStrCopy(&c->b, &c->a);
+}
+
+static void xInitExternal(Ctx *c)
+{
+	xStr s;
+	xStrInitExternal(&s, c->text, c->size, NULL, NULL);
+	c->sink += s.len;
+	xStrCleanup(&s);
+}
+
+static void xSetAllocator(Ctx *c)
+{
+	xStrSetAllocator(&c->a, xStrArenaAllocator(&c->arena));
+	xStrSetAllocator(&c->a, NULL);
+	xStrArenaReset(&c->arena);
+}
+
+static void xArenaAlloc(Ctx *c)
+{
+	for (xStrSize i = 0; i < c->size; i += CHUNK_LEN)
+		c->sink += (long)xStrArenaAlloc(&c->arena, CHUNK_LEN) & 1;
+	xStrArenaReset(&c->arena);
+}
+
+static void cArenaAlloc(Ctx *c)
+{
+	void *ptrs[1024];
+	xStrSize n = 0;
+	for (xStrSize i = 0; i < c->size; i += CHUNK_LEN) {
+		if (n == 1024) {
+			while (n > 0)
+				free(ptrs[--n]);
+		}
+		ptrs[n++] = malloc(CHUNK_LEN);
+	}
+	while (n > 0)
+		free(ptrs[--n]);
+}
+
+// Capacity
+
+static void xClear(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	xStrClear(&c->a);
+}
+
+static void xCompact(Ctx *c)
+{
+	xStrReserve(&c->a, c->size * 2);
+	xStrCompact(&c->a);
+}
+
+static void xReserve(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	xStrReserve(&s, c->size);
+	c->sink += s.cap;
+	xStrCleanup(&s);
+}
+
+static void cReserve(Ctx *c)
+{
+	char *p = malloc(c->size + 1);
+	c->sink += (long)(size_t)p;
+	free(p);
+}
+
+static void xResize(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	xStrResize(&s, c->size);
+	c->sink += s.len;
+	xStrCleanup(&s);
+}
+
+static void cResize(Ctx *c)
+{
+	char *p = calloc(c->size + 1, 1);
+	c->sink += (long)(size_t)p;
+	free(p);
+}
+
+static void xSwap(Ctx *c)
+{
+	xStrSwap(&c->a, &c->b);
+	xStrSwap(&c->a, &c->b);
+}
+
+// Assignment
+
+static void xAssign(Ctx *c)
+{
+	xStrAssign(&c->a, c->text);
+}
+
+static void xAssignLen(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+}
+
+static void cAssignLen(Ctx *c)
+{
+	c->buf.len = 0;
+	bufAppend(&c->buf, c->text, c->size);
+}
+
+static void xAssignCh(Ctx *c)
+{
+	for (xStrSize i = 0; i < c->size; i++)
+		xStrAssignCh(&c->a, c->text[i]);
+}
+
+static void xAssignFmt(Ctx *c)
+{
+	xStrAssignFmt(&c->a, "%s", c->text);
+}
+
+static void cAssignFmt(Ctx *c)
+{
+	bufReserve(&c->buf, c->size);
+	c->buf.len = snprintf(c->buf.p, c->buf.cap, "%s", c->text);
+}
+
+// Append-heavy: build size bytes from scratch in small pieces
+
+static void xAppend(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	while (s.len < c->size)
+		xStrAppend(&s, CHUNK);
+	xStrCleanup(&s);
+}
+
+static void xAppendLen(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (xStrSize i = 0; i < c->size; i += CHUNK_LEN)
+		xStrAppendLen(&s, c->text + i, chunkLen(c, i));
+	xStrCleanup(&s);
+}
+
+static void cAppendLen(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	for (xStrSize i = 0; i < c->size; i += CHUNK_LEN)
+		bufAppend(&b, c->text + i, chunkLen(c, i));
+	bufFree(&b);
+}
+
+static void xAppendCh(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (xStrSize i = 0; i < c->size; i++)
+		xStrAppendCh(&s, c->text[i]);
+	xStrCleanup(&s);
+}
+
+static void cAppendCh(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	for (xStrSize i = 0; i < c->size; i++) {
+		bufReserve(&b, b.len + 1);
+		b.p[b.len++] = c->text[i];
+	}
+	bufFree(&b);
+}
+
+static void xAppendFmt(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (int i = 0; s.len < c->size; i++)
+		xStrAppendFmt(&s, "%d,", i);
+	xStrCleanup(&s);
+}
+
+static void cAppendFmt(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	for (int i = 0; b.len < (size_t)c->size; i++) {
+		bufReserve(&b, b.len + 16);
+		b.len += snprintf(b.p + b.len, b.cap - b.len, "%d,", i);
+	}
+	bufFree(&b);
+}
+
+static void xAppendInt(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (int i = 0; s.len < c->size; i++) {
+		xStrAppendInt(&s, i);
+		xStrAppendCh(&s, ',');
+	}
+	xStrCleanup(&s);
+}
+
+static void xAppendUInt(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (int i = 0; s.len < c->size; i++) {
+		xStrAppendUInt(&s, WIDE(i));
+		xStrAppendCh(&s, ',');
+	}
+	xStrCleanup(&s);
+}
+
+static void cAppendUInt(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	for (int i = 0; b.len < (size_t)c->size; i++) {
+		bufReserve(&b, b.len + 32);
+		b.len += snprintf(b.p + b.len, b.cap - b.len, "%llu,", WIDE(i));
+	}
+	bufFree(&b);
+}
+
+static void xAppendHex(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (int i = 0; s.len < c->size; i++) {
+		xStrAppendHex(&s, WIDE(i));
+		xStrAppendCh(&s, ',');
+	}
+	xStrCleanup(&s);
+}
+
+static void cAppendHex(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	for (int i = 0; b.len < (size_t)c->size; i++) {
+		bufReserve(&b, b.len + 32);
+		b.len += snprintf(b.p + b.len, b.cap - b.len, "%llx,", WIDE(i));
+	}
+	bufFree(&b);
+}
+
+static void xAppendDouble(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (int i = 0; s.len < c->size; i++) {
+		xStrAppendDouble(&s, i * 0.37);
+		xStrAppendCh(&s, ',');
+	}
+	xStrCleanup(&s);
+}
+
+// %.17g always reads back, but isn't the shortest form
+static void cAppendDouble(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	for (int i = 0; b.len < (size_t)c->size; i++) {
+		bufReserve(&b, b.len + 32);
+		b.len += snprintf(b.p + b.len, b.cap - b.len, "%.17g,", i * 0.37);
+	}
+	bufFree(&b);
+}
+
+static void xAppendView(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	for (xStrSize i = 0; i + CHUNK_LEN <= c->size; i += CHUNK_LEN)
+		xStrAppendView(&s, xStrViewMake(c->text + i, CHUNK_LEN));
+	xStrCleanup(&s);
+}
+
+static void xAppendMany(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, "");
+	while (s.len < c->size)
+		xStrAppendMany(&s, CHUNK, CHUNK, CHUNK, CHUNK, NULL);
+	xStrCleanup(&s);
+}
+
+static void cAppendMany(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	while (b.len < (size_t)c->size) {
+		for (int i = 0; i < 4; i++)
+			bufAppend(&b, CHUNK, CHUNK_LEN);
+	}
+	bufFree(&b);
+}
+
+static void xConcat(Ctx *c)
+{
+	xStrConcat(&c->a, c->text, ",", c->text, NULL);
+}
+
+static void cConcat(Ctx *c)
+{
+	c->buf.len = 0;
+	bufAppend(&c->buf, c->text, c->size);
+	bufAppend(&c->buf, ",", 1);
+	bufAppend(&c->buf, c->text, c->size);
+}
+
+// Front and middle edits; quadratic by nature, so sizes are capped
+
+static void xPrepend(Ctx *c)
+{
+	xStrClear(&c->a);
+	while (c->a.len < c->size)
+		xStrPrepend(&c->a, CHUNK);
+}
+
+static void xPrependLen(Ctx *c)
+{
+	xStrClear(&c->a);
+	while (c->a.len < c->size)
+		xStrPrependLen(&c->a, CHUNK, CHUNK_LEN);
+}
+
+static void cPrependLen(Ctx *c)
+{
+	Buf *b = &c->buf;
+	b->len = 0;
+	while (b->len < (size_t)c->size) {
+		bufReserve(b, b->len + CHUNK_LEN);
+		memmove(b->p + CHUNK_LEN, b->p, b->len);
+		memcpy(b->p, CHUNK, CHUNK_LEN);
+		b->len += CHUNK_LEN;
+		b->p[b->len] = '\0';
+	}
+}
+
+static void xPrependCh(Ctx *c)
+{
+	xStrClear(&c->a);
+	while (c->a.len < c->size)
+		xStrPrependCh(&c->a, 'x');
+}
+
+static void xPrependFmt(Ctx *c)
+{
+	xStrClear(&c->a);
+	for (int i = 0; c->a.len < c->size; i++)
+		xStrPrependFmt(&c->a, "%d,", i);
+}
+
+static void xInsert(Ctx *c)
+{
+	xStrClear(&c->a);
+	while (c->a.len < c->size)
+		xStrInsert(&c->a, c->a.len / 2, CHUNK);
+}
+
+static void xInsertLen(Ctx *c)
+{
+	xStrClear(&c->a);
+	while (c->a.len < c->size)
+		xStrInsertLen(&c->a, c->a.len / 2, CHUNK, CHUNK_LEN);
+}
+
+static void cInsertLen(Ctx *c)
+{
+	Buf *b = &c->buf;
+	b->len = 0;
+	while (b->len < (size_t)c->size) {
+		const size_t pos = b->len / 2;
+		bufReserve(b, b->len + CHUNK_LEN);
+		memmove(b->p + pos + CHUNK_LEN, b->p + pos, b->len - pos);
+		memcpy(b->p + pos, CHUNK, CHUNK_LEN);
+		b->len += CHUNK_LEN;
+		b->p[b->len] = '\0';
+	}
+}
+
+static void xInsertCh(Ctx *c)
+{
+	xStrClear(&c->a);
+	while (c->a.len < c->size)
+		xStrInsertCh(&c->a, c->a.len / 2, 'x');
+}
+
+static void xInsertFmt(Ctx *c)
+{
+	xStrClear(&c->a);
+	for (int i = 0; c->a.len < c->size; i++)
+		xStrInsertFmt(&c->a, c->a.len / 2, "%d,", i);
+}
+
+static void xInsertView(Ctx *c)
+{
+	xStrClear(&c->a);
+	while (c->a.len < c->size)
+		xStrInsertView(&c->a, c->a.len / 2, xStrViewMake(CHUNK, CHUNK_LEN));
+}
+
+static void xErase(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	while (c->a.len > 0)
+		xStrErase(&c->a, 0, CHUNK_LEN);
+}
+
+static void cErase(Ctx *c)
+{
+	Buf *b = &c->buf;
+	b->len = 0;
+	bufAppend(b, c->text, c->size);
+	while (b->len > 0) {
+		const size_t n = b->len < CHUNK_LEN ? b->len : CHUNK_LEN;
+		memmove(b->p, b->p + n, b->len - n + 1);
+		b->len -= n;
+	}
+}
+
+// Overwrites every 64th position of a string that already holds the text
+
+static void xOverwrite(Ctx *c)
+{
+	for (xStrSize i = 0; i + CHUNK_LEN <= c->a.len; i += 64)
+		xStrOverwrite(&c->a, i, CHUNK_LEN, CHUNK);
+}
+
+static void xOverwriteLen(Ctx *c)
+{
+	for (xStrSize i = 0; i + CHUNK_LEN <= c->a.len; i += 64)
+		xStrOverwriteLen(&c->a, i, CHUNK_LEN, CHUNK, CHUNK_LEN);
+}
+
+static void cOverwriteLen(Ctx *c)
+{
+	for (size_t i = 0; i + CHUNK_LEN <= c->buf.len; i += 64)
+		memcpy(c->buf.p + i, CHUNK, CHUNK_LEN);
+}
+
+static void xOverwriteCh(Ctx *c)
+{
+	for (xStrSize i = 0; i < c->a.len; i += 64)
+		xStrOverwriteCh(&c->a, i, 1, 'x');
+}
+
+static void xOverwriteFmt(Ctx *c)
+{
+	for (xStrSize i = 0; i + CHUNK_LEN <= c->a.len; i += 64)
+		xStrOverwriteFmt(&c->a, i, 6, "%06d", (int)i % 1000000);
+}
+
+// Replace-heavy; "ab" occurs about once every 300 bytes
+
+static void xReplaceShrink(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	xStrReplace(&c->a, "ab", "x", 0);
+}
+
+static void xReplaceGrow(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	xStrReplace(&c->a, "ab", "xyz", 0);
+}
+
+static void xReplaceLen(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	xStrReplaceLen(&c->a, "ab", 2, "xy", 2, 0);
+}
+
+static void cReplace(Ctx *c, const char *needle, const char *repl)
+{
+	const size_t nlen = strlen(needle), rlen = strlen(repl);
+	Buf *b = &c->buf;
+	const char *p = c->text, *m;
+	b->len = 0;
+	while ((m = strstr(p, needle)) != NULL) {
+		bufAppend(b, p, m - p);
+		bufAppend(b, repl, rlen);
+		p = m + nlen;
+	}
+	bufAppend(b, p, c->text + c->size - p);
+}
+
+static void cReplaceShrink(Ctx *c)
+{
+	cReplace(c, "ab", "x");
+}
+
+static void cReplaceGrow(Ctx *c)
+{
+	cReplace(c, "ab", "xyz");
+}
+
+static void cReplaceLen(Ctx *c)
+{
+	cReplace(c, "ab", "xy");
+}
+
+// Stripping
+
+static void xStripFront(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->padded, c->size + 32);
+	xStrStripFront(&c->a, NULL);
+}
+
+static void xStripBack(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->padded, c->size + 32);
+	xStrStripBack(&c->a, NULL);
+}
+
+static void xStrip(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->padded, c->size + 32);
+	xStrStrip(&c->a, NULL);
+}
+
+static void cStrip(Ctx *c)
+{
+	const char *p = c->padded, *e = c->padded + c->size + 32;
+	while (p < e && isspace((unsigned char)*p))
+		p++;
+	while (e > p && isspace((unsigned char)e[-1]))
+		e--;
+	c->buf.len = 0;
+	bufAppend(&c->buf, p, e - p);
+}
+
+// Comparison of two equal, separately allocated strings
+
+static void xCompare(Ctx *c)
+{
+	c->sink += xStrCompare(&c->a, &c->b);
+}
+
+static void cCompare(Ctx *c)
+{
+	c->sink += memcmp(c->a.str, c->b.str, c->size);
+}
+
+static void xCaseCompare(Ctx *c)
+{
+	c->sink += xStrCaseCompare(&c->a, &c->b);
+}
+
+static void cCaseCompare(Ctx *c)
+{
+	c->sink += strcasecmp(c->a.str, c->b.str);
+}
+
+static void xCaseCompareLocale(Ctx *c)
+{
+	c->sink += xStrCaseCompareLocale(&c->a, &c->b);
+}
+
+static void xEqual(Ctx *c)
+{
+	c->sink += xStrEqual(&c->a, &c->b);
+}
+
+// Case mapping in place
+
+static void xToUpper(Ctx *c)
+{
+	xStrToUpper(&c->a);
+}
+
+static void cToUpper(Ctx *c)
+{
+	for (size_t i = 0; i < c->buf.len; i++)
+		c->buf.p[i] = toupper((unsigned char)c->buf.p[i]);
+}
+
+static void xToLower(Ctx *c)
+{
+	xStrToLower(&c->a);
+}
+
+static void cToLower(Ctx *c)
+{
+	for (size_t i = 0; i < c->buf.len; i++)
+		c->buf.p[i] = tolower((unsigned char)c->buf.p[i]);
+}
+
+static void xToUpperLocale(Ctx *c)
+{
+	xStrToUpperLocale(&c->a);
+}
+
+static void xToLowerLocale(Ctx *c)
+{
+	xStrToLowerLocale(&c->a);
+}
+
+// Search-heavy; the needles never occur, so every byte is examined
+
+static void xFirstIndexOf(Ctx *c)
+{
+	c->sink += xStrFirstIndexOf(&c->a, MISSING);
+}
+
+static void cFirstIndexOf(Ctx *c)
+{
+	c->sink += strstr(c->a.str, MISSING) != NULL;
+}
+
+static void xFirstIndexOfLen(Ctx *c)
+{
+	c->sink += xStrFirstIndexOfLen(&c->a, MISSING, 8);
+}
+
+static void xFirstIndexOfCh(Ctx *c)
+{
+	c->sink += xStrFirstIndexOfCh(&c->a, 'z');
+}
+
+static void cFirstIndexOfCh(Ctx *c)
+{
+	c->sink += memchr(c->a.str, 'z', c->size) != NULL;
+}
+
+static void xLastIndexOf(Ctx *c)
+{
+	c->sink += xStrLastIndexOf(&c->a, MISSING);
+}
+
+static void xLastIndexOfLen(Ctx *c)
+{
+	c->sink += xStrLastIndexOfLen(&c->a, MISSING, 8);
+}
+
+static void xLastIndexOfCh(Ctx *c)
+{
+	c->sink += xStrLastIndexOfCh(&c->a, 'z');
+}
+
+static void cLastIndexOfCh(Ctx *c)
+{
+	c->sink += strrchr(c->a.str, 'z') != NULL;
+}
+
+static void xStartsWith(Ctx *c)
+{
+	c->sink += xStrStartsWith(&c->a, "abcdefgh");
+}
+
+static void cStartsWith(Ctx *c)
+{
+	c->sink += strncmp(c->a.str, "abcdefgh", 8) == 0;
+}
+
+static void xStartsWithLen(Ctx *c)
+{
+	c->sink += xStrStartsWithLen(&c->a, "abcdefgh", 8);
+}
+
+static void xEndsWith(Ctx *c)
+{
+	c->sink += xStrEndsWith(&c->a, "abcdefgh");
+}
+
+static void xEndsWithLen(Ctx *c)
+{
+	c->sink += xStrEndsWithLen(&c->a, "abcdefgh", 8);
+}
+
+// Padding to twice the length
+
+static void xLeftJustify(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	xStrLeftJustify(&c->a, c->size * 2, ' ');
+}
+
+static void xRightJustify(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	xStrRightJustify(&c->a, c->size * 2, ' ');
+}
+
+static void cRightJustify(Ctx *c)
+{
+	Buf *b = &c->buf;
+	bufReserve(b, c->size * 2);
+	memset(b->p, ' ', c->size);
+	memcpy(b->p + c->size, c->text, c->size + 1);
+	b->len = c->size * 2;
+}
+
+static void xCenter(Ctx *c)
+{
+	xStrAssignLen(&c->a, c->text, c->size);
+	xStrCenter(&c->a, c->size * 2, ' ');
+}
+
+// Views
+
+static void xSlice(Ctx *c)
+{
+	for (xStrSize i = 0; i < c->size; i += CHUNK_LEN)
+		c->sink += xStrSlice(&c->a, i, CHUNK_LEN).len;
+}
+
+static void xViewSlice(Ctx *c)
+{
+	const xStrView v = xStrViewOf(&c->a);
+	for (xStrSize i = 0; i < c->size; i += CHUNK_LEN)
+		c->sink += xStrViewSlice(v, i, CHUNK_LEN).len;
+}
+
+static void xViewFirstIndexOf(Ctx *c)
+{
+	c->sink += xStrViewFirstIndexOf(xStrViewOf(&c->a), xStrViewMake(MISSING, 8));
+}
+
+static void xViewFirstIndexOfCh(Ctx *c)
+{
+	c->sink += xStrViewFirstIndexOfCh(xStrViewOf(&c->a), 'z');
+}
+
+static void xViewLastIndexOf(Ctx *c)
+{
+	c->sink += xStrViewLastIndexOf(xStrViewOf(&c->a), xStrViewMake(MISSING, 8));
+}
+
+static void xViewLastIndexOfCh(Ctx *c)
+{
+	c->sink += xStrViewLastIndexOfCh(xStrViewOf(&c->a), 'z');
+}
+
+static void xViewCompare(Ctx *c)
+{
+	c->sink += xStrViewCompare(xStrViewOf(&c->a), xStrViewOf(&c->b));
+}
+
+static void xViewCaseCompare(Ctx *c)
+{
+	c->sink += xStrViewCaseCompare(xStrViewOf(&c->a), xStrViewOf(&c->b));
+}
+
+static void xViewEqual(Ctx *c)
+{
+	c->sink += xStrViewEqual(xStrViewOf(&c->a), xStrViewOf(&c->b));
+}
+
+static void xViewStartsWith(Ctx *c)
+{
+	c->sink += xStrViewStartsWith(xStrViewOf(&c->a), xStrViewMake("abcdefgh", 8));
+}
+
+static void xViewEndsWith(Ctx *c)
+{
+	c->sink += xStrViewEndsWith(xStrViewOf(&c->a), xStrViewMake("abcdefgh", 8));
+}
+
+static void xViewStripFront(Ctx *c)
+{
+	c->sink += xStrViewStripFront(xStrViewMake(c->padded, c->size + 32), NULL).len;
+}
+
+static void xViewStripBack(Ctx *c)
+{
+	c->sink += xStrViewStripBack(xStrViewMake(c->padded, c->size + 32), NULL).len;
+}
+
+static void xViewStrip(Ctx *c)
+{
+	c->sink += xStrViewStrip(xStrViewMake(c->padded, c->size + 32), NULL).len;
+}
+
+static void xInitView(Ctx *c)
+{
+	xStr s;
+	xStrInitView(&s, xStrViewMake(c->text, c->size));
+	c->sink += s.len;
+	xStrCleanup(&s);
+}
+
+static void xAssignView(Ctx *c)
+{
+	xStrAssignView(&c->a, xStrViewMake(c->text, c->size));
+}
+
+// Splitting and joining; fields are the runs between commas
+
+static void xSplitCh(Ctx *c)
+{
+	xStrSplitIter it;
+	xStrView field;
+	xStrSplitInitCh(&it, xStrViewMake(c->text, c->size), ',');
+	while (xStrSplitNext(&it, &field))
+		c->sink += field.len;
+}
+
+static void cSplitCh(Ctx *c)
+{
+	const char *p = c->text, *end = c->text + c->size, *m;
+	while ((m = memchr(p, ',', end - p)) != NULL) {
+		c->sink += m - p;
+		p = m + 1;
+	}
+	c->sink += end - p;
+}
+
+static void xSplitStr(Ctx *c)
+{
+	xStrSplitIter it;
+	xStrView field;
+	xStrSplitInitStr(&it, xStrViewMake(c->text, c->size), xStrViewMake(",a", 2));
+	while (xStrSplitNext(&it, &field))
+		c->sink += field.len;
+}
+
+static void xSplitAny(Ctx *c)
+{
+	xStrSplitIter it;
+	xStrView field;
+	xStrSplitInitAny(&it, xStrViewMake(c->text, c->size), ",p");
+	while (xStrSplitNext(&it, &field))
+		c->sink += field.len;
+}
+
+static void cSplitAny(Ctx *c)
+{
+	const char *p = c->text;
+	for (;;) {
+		const size_t n = strcspn(p, ",p");
+		c->sink += n;
+		if (!p[n])
+			break;
+		p += n + 1;
+	}
+}
+
+static void xJoin(Ctx *c)
+{
+	xStrJoin(&c->a, xStrViewMake(",", 1), c->views, c->nparts);
+}
+
+static void cJoin(Ctx *c)
+{
+	Buf *b = &c->buf;
+	b->len = 0;
+	for (xStrSize i = 0; i < c->nparts; i++) {
+		if (i > 0)
+			bufAppend(b, ",", 1);
+		bufAppend(b, c->views[i].str, c->views[i].len);
+	}
+}
+
+static void xJoinStrs(Ctx *c)
+{
+	xStrJoinStrs(&c->a, xStrViewMake(",", 1), c->strs, c->nparts);
+}
+
+// Gluing the fields back together into a new string
+static void xAppendViews(Ctx *c)
+{
+	xStr s;
+	xStrInit(&s, NULL);
+	xStrAppendViews(&s, c->views, c->nparts);
+	c->sink += s.len;
+	xStrCleanup(&s);
+}
+
+static void cAppendViews(Ctx *c)
+{
+	Buf b = { NULL, 0, 0 };
+	for (xStrSize i = 0; i < c->nparts; i++)
+		bufAppend(&b, c->views[i].str, c->views[i].len);
+	c->sink += b.len;
+	bufFree(&b);
+}
+
+// Ropes; middle inserts are cheap, so the libc row stops much sooner
+
+static void xRopeAppendLen(Ctx *c)
+{
+	xStrRope r;
+	xStrRopeInit(&r);
+	for (xStrSize i = 0; i < c->size; i += CHUNK_LEN)
+		xStrRopeAppendLen(&r, c->text + i, chunkLen(c, i));
+	c->sink += xStrRopeSegments(&r);
+	xStrRopeCleanup(&r);
+}
+
+static void xRopeInsertLen(Ctx *c)
+{
+	xStrRope r;
+	xStrRopeInit(&r);
+	while (xStrRopeLength(&r) < c->size)
+		xStrRopeInsertLen(&r, xStrRopeLength(&r) / 2, CHUNK, CHUNK_LEN);
+	c->sink += xStrRopeSegments(&r);
+	xStrRopeCleanup(&r);
+}
+
+// Gap buffers; each middle insert moves the gap only a few bytes
+
+static void xGapInsertLen(Ctx *c)
+{
+	xStrGap g;
+	xStrGapInit(&g, NULL);
+	while (xStrGapLength(&g) < c->size)
+		xStrGapInsertLen(&g, xStrGapLength(&g) / 2, CHUNK, CHUNK_LEN);
+	c->sink += xStrGapCursor(&g);
+	xStrGapCleanup(&g);
+}
+
+static void xGapInsertCh(Ctx *c)
+{
+	xStrGap g;
+	xStrGapInit(&g, NULL);
+	while (xStrGapLength(&g) < c->size)
+		xStrGapInsertCh(&g, xStrGapLength(&g) / 2, 'x');
+	c->sink += xStrGapCursor(&g);
+	xStrGapCleanup(&g);
+}
+
+// Maps keyed by the fields
+
+static void xMapSet(Ctx *c)
+{
+	xStrMap m;
+	xStrMapInit(&m);
+	for (xStrSize i = 0; i < c->nparts; i++)
+		xStrMapSet(&m, c->views[i], &c->views[i]);
+	c->sink += xStrMapCount(&m);
+	xStrMapCleanup(&m);
+}
+
+static void xMapGet(Ctx *c)
+{
+	if (xStrMapCount(&c->map) == 0) {
+		for (xStrSize i = 0; i < c->nparts; i++)
+			xStrMapSet(&c->map, c->views[i], &c->views[i]);
+	}
+	for (xStrSize i = 0; i < c->nparts; i++)
+		c->sink += xStrMapGet(&c->map, c->views[i]) != NULL;
+}
+
+// Interning the fields; most are distinct
+
+static void xIntern(Ctx *c)
+{
+	xStrPool p;
+	xStrPoolInit(&p);
+	for (xStrSize i = 0; i < c->nparts; i++)
+		c->sink += xStrIntern(&p, c->views[i])->len;
+	xStrPoolCleanup(&p);
+}
+
+static void xInternHit(Ctx *c)
+{
+	for (xStrSize i = 0; i < c->nparts; i++)
+		c->sink += xStrIntern(&c->pool, c->views[i])->len;
+}
+
+// Lists of the fields
+
+static void xListAppend(Ctx *c)
+{
+	xStrList l;
+	xStrListInit(&l);
+	for (xStrSize i = 0; i < c->nparts; i++)
+		xStrListAppendView(&l, c->views[i]);
+	c->sink += xStrListBytes(&l);
+	xStrListCleanup(&l);
+}
+
+static void xListSort(Ctx *c)
+{
+	xStrList l;
+	xStrListInit(&l);
+	for (xStrSize i = 0; i < c->nparts; i++)
+		xStrListAppendView(&l, c->views[i]);
+	xStrListSort(&l);
+	c->sink += xStrListGet(&l, 0).len;
+	xStrListCleanup(&l);
+}
+
+static int viewCmp(const void *a, const void *b)
+{
+	const xStrView *x = a, *y = b;
+	const int r = memcmp(x->str, y->str, (x->len < y->len) ? x->len : y->len);
+	return r ? r : (x->len > y->len) - (x->len < y->len);
+}
+
+static void cListSort(Ctx *c)
+{
+	xStrView *v = malloc(c->nparts * sizeof(xStrView));
+	memcpy(v, c->views, c->nparts * sizeof(xStrView));
+	qsort(v, c->nparts, sizeof(xStrView), viewCmp);
+	c->sink += v[0].len;
+	free(v);
+}
+
+// Loading the text from a file; every page is touched once
+
+static void xMapFile(Ctx *c)
+{
+	xStr s;
+	if (!xStrMapFile(&s, ctxFile(c), XSTR_MAP_SEQUENTIAL)) {
+		perror("xStrMapFile");
+		exit(1);
+	}
+	for (xStrSize i = 0; i < s.len; i += 4096)
+		c->sink += s.str[i];
+	xStrCleanup(&s);
+}
+
+static void cMapFile(Ctx *c)
+{
+	FILE *fp = fopen(ctxFile(c), "rb");
+	char *p = malloc(c->size + 1);
+	if (!fp || !p) {
+		perror("fopen");
+		exit(1);
+	}
+	const size_t n = fread(p, 1, c->size, fp);
+	p[n] = '\0';
+	fclose(fp);
+	for (size_t i = 0; i < n; i += 4096)
+		c->sink += p[i];
+	free(p);
+}
+
+// Reading the fields back from the file
+
+static void xReadRecords(Ctx *c)
+{
+	xStrReader r;
+	xStrView field;
+	const int fd = open(ctxFile(c), O_RDONLY);
+	if (fd < 0) {
+		perror("open");
+		exit(1);
+	}
+	xStrReaderInit(&r, fd);
+	while (xStrReaderNext(&r, ',', &field) > 0)
+		c->sink += field.len;
+	xStrReaderCleanup(&r);
+	close(fd);
+}
+
+static void cReadRecords(Ctx *c)
+{
+	FILE *fp = fopen(ctxFile(c), "rb");
+	char *line = NULL;
+	size_t cap = 0;
+	ssize_t n;
+	if (!fp) {
+		perror("fopen");
+		exit(1);
+	}
+	while ((n = getdelim(&line, &cap, ',', fp)) > 0)
+		c->sink += n - (line[n - 1] == ',');
+	free(line);
+	fclose(fp);
+}
+
+// Writing the fields to /dev/null, so only the batching is measured
+
+static void xWriteViews(Ctx *c)
+{
+	xStrWriter w;
+	const int fd = open("/dev/null", O_WRONLY);
+	if (fd < 0) {
+		perror("open");
+		exit(1);
+	}
+	xStrWriterInit(&w, fd);
+	for (xStrSize i = 0; i < c->nparts; i++)
+		xStrWriterAddView(&w, c->views[i]);
+	c->sink += xStrWriterFlush(&w);
+	xStrWriterCleanup(&w);
+	close(fd);
+}
+
+static void xWriteStrs(Ctx *c)
+{
+	xStrWriter w;
+	const int fd = open("/dev/null", O_WRONLY);
+	if (fd < 0) {
+		perror("open");
+		exit(1);
+	}
+	xStrWriterInit(&w, fd);
+	for (xStrSize i = 0; i < c->nparts; i++)
+		xStrWriterAdd(&w, &c->strs[i]);
+	c->sink += xStrWriterFlush(&w);
+	xStrWriterCleanup(&w);
+	close(fd);
+}
+
+static void cWriteViews(Ctx *c)
+{
+	FILE *fp = fopen("/dev/null", "wb");
+	if (!fp) {
+		perror("fopen");
+		exit(1);
+	}
+	for (xStrSize i = 0; i < c->nparts; i++)
+		fwrite(c->views[i].str, 1, c->views[i].len, fp);
+	c->sink += fflush(fp);
+	fclose(fp);
+}
+
+// Hashing
+
+static void xHash(Ctx *c)
+{
+	c->sink += (long)xStrHash(&c->a);
+}
+
+static void xHashLen(Ctx *c)
+{
+	c->sink += (long)xStrHashLen(c->text, c->size, 1);
+}
+
+static void xViewHash(Ctx *c)
+{
+	c->sink += (long)xStrViewHash(xStrViewOf(&c->a));
+}
+
+static const Bench benches[] = {
+	{ "init", "xstr", 0, xInit },
+	{ "init_len", "xstr", 0, xInitLen },
+	{ "init_len", "libc", 0, cInitLen },
+	{ "init_alloc", "xstr", 0, xInitAlloc },
+	{ "init_len_alloc", "xstr", 0, xInitLenAlloc },
+	{ "init_view", "xstr", 0, xInitView },
+	{ "new", "xstr", 0, xNew },
+	{ "new_len", "xstr", 0, xNewLen },
+	{ "init_copy", "xstr", 0, xInitCopy },
+	{ "init_copy", "libc", 0, cInitLen },
+	{ "copy", "xstr", 0, xCopy },
+	{ "copy", "libc", 0, cAssignLen },
+	{ "init_external", "xstr", 0, xInitExternal },
+	{ "init_external", "libc", 0, cInitLen },
+	{ "set_allocator", "xstr", 0, xSetAllocator },
+	{ "arena_alloc", "xstr", 0, xArenaAlloc },
+	{ "arena_alloc", "libc", 0, cArenaAlloc },
+
+	{ "clear", "xstr", 0, xClear },
+	{ "compact", "xstr", 0, xCompact },
+	{ "reserve", "xstr", 0, xReserve },
+	{ "reserve", "libc", 0, cReserve },
+	{ "resize", "xstr", 0, xResize },
+	{ "resize", "libc", 0, cResize },
+	{ "swap", "xstr", 0, xSwap },
+
+	{ "assign", "xstr", 0, xAssign },
+	{ "assign_len", "xstr", 0, xAssignLen },
+	{ "assign_len", "libc", 0, cAssignLen },
+	{ "assign_ch", "xstr", 0, xAssignCh },
+	{ "assign_fmt", "xstr", 0, xAssignFmt },
+	{ "assign_fmt", "libc", 0, cAssignFmt },
+	{ "assign_view", "xstr", 0, xAssignView },
+
+	{ "append", "xstr", 0, xAppend },
+	{ "append_len", "xstr", 0, xAppendLen },
+	{ "append_len", "libc", 0, cAppendLen },
+	{ "append_ch", "xstr", 0, xAppendCh },
+	{ "append_ch", "libc", 0, cAppendCh },
+	{ "append_fmt", "xstr", FORMATTED, xAppendFmt },
+	{ "append_fmt", "libc", FORMATTED, cAppendFmt },
+	{ "append_int", "xstr", FORMATTED, xAppendInt },
+	{ "append_int", "libc", FORMATTED, cAppendFmt },
+	{ "append_uint", "xstr", FORMATTED, xAppendUInt },
+	{ "append_uint", "libc", FORMATTED, cAppendUInt },
+	{ "append_hex", "xstr", FORMATTED, xAppendHex },
+	{ "append_hex", "libc", FORMATTED, cAppendHex },
+	{ "append_double", "xstr", FORMATTED, xAppendDouble },
+	{ "append_double", "libc", FORMATTED, cAppendDouble },
+	{ "append_view", "xstr", 0, xAppendView },
+	{ "append_many", "xstr", 0, xAppendMany },
+	{ "append_many", "libc", 0, cAppendMany },
+	{ "concat", "xstr", 0, xConcat },
+	{ "concat", "libc", 0, cConcat },
+
+	{ "prepend", "xstr", QUADRATIC, xPrepend },
+	{ "prepend_len", "xstr", QUADRATIC, xPrependLen },
+	{ "prepend_len", "libc", QUADRATIC, cPrependLen },
+	{ "prepend_ch", "xstr", QUADRATIC, xPrependCh },
+	{ "prepend_fmt", "xstr", QUADRATIC, xPrependFmt },
+	{ "insert", "xstr", QUADRATIC, xInsert },
+	{ "insert_len", "xstr", QUADRATIC, xInsertLen },
+	{ "insert_len", "libc", QUADRATIC, cInsertLen },
+	{ "insert_ch", "xstr", QUADRATIC, xInsertCh },
+	{ "insert_fmt", "xstr", QUADRATIC, xInsertFmt },
+	{ "insert_view", "xstr", QUADRATIC, xInsertView },
+	{ "erase", "xstr", QUADRATIC, xErase },
+	{ "erase", "libc", QUADRATIC, cErase },
+
+	{ "overwrite", "xstr", 0, xOverwrite },
+	{ "overwrite_len", "xstr", 0, xOverwriteLen },
+	{ "overwrite_len", "libc", 0, cOverwriteLen },
+	{ "overwrite_ch", "xstr", 0, xOverwriteCh },
+	{ "overwrite_fmt", "xstr", 0, xOverwriteFmt },
+
+	{ "replace_shrink", "xstr", 0, xReplaceShrink },
+	{ "replace_shrink", "libc", 0, cReplaceShrink },
+	{ "replace_grow", "xstr", 0, xReplaceGrow },
+	{ "replace_grow", "libc", 0, cReplaceGrow },
+	{ "replace_len", "xstr", 0, xReplaceLen },
+	{ "replace_len", "libc", 0, cReplaceLen },
+
+	{ "strip_front", "xstr", 0, xStripFront },
+	{ "strip_back", "xstr", 0, xStripBack },
+	{ "strip", "xstr", 0, xStrip },
+	{ "strip", "libc", 0, cStrip },
+
+	{ "compare", "xstr", 0, xCompare },
+	{ "compare", "libc", 0, cCompare },
+	{ "case_compare", "xstr", 0, xCaseCompare },
+	{ "case_compare", "libc", 0, cCaseCompare },
+	{ "case_compare_locale", "xstr", 0, xCaseCompareLocale },
+	{ "equal", "xstr", 0, xEqual },
+
+	{ "to_upper", "xstr", 0, xToUpper },
+	{ "to_upper", "libc", 0, cToUpper },
+	{ "to_lower", "xstr", 0, xToLower },
+	{ "to_lower", "libc", 0, cToLower },
+	{ "to_upper_locale", "xstr", 0, xToUpperLocale },
+	{ "to_lower_locale", "xstr", 0, xToLowerLocale },
+
+	{ "first_index_of", "xstr", 0, xFirstIndexOf },
+	{ "first_index_of", "libc", 0, cFirstIndexOf },
+	{ "first_index_of_len", "xstr", 0, xFirstIndexOfLen },
+	{ "first_index_of_ch", "xstr", 0, xFirstIndexOfCh },
+	{ "first_index_of_ch", "libc", 0, cFirstIndexOfCh },
+	{ "last_index_of", "xstr", 0, xLastIndexOf },
+	{ "last_index_of_len", "xstr", 0, xLastIndexOfLen },
+	{ "last_index_of_ch", "xstr", 0, xLastIndexOfCh },
+	{ "last_index_of_ch", "libc", 0, cLastIndexOfCh },
+	{ "starts_with", "xstr", 0, xStartsWith },
+	{ "starts_with", "libc", 0, cStartsWith },
+	{ "starts_with_len", "xstr", 0, xStartsWithLen },
+	{ "ends_with", "xstr", 0, xEndsWith },
+	{ "ends_with_len", "xstr", 0, xEndsWithLen },
+
+	{ "left_justify", "xstr", 0, xLeftJustify },
+	{ "right_justify", "xstr", 0, xRightJustify },
+	{ "right_justify", "libc", 0, cRightJustify },
+	{ "center", "xstr", 0, xCenter },
+
+	{ "slice", "xstr", 0, xSlice },
+	{ "view_slice", "xstr", 0, xViewSlice },
+	{ "view_first_index_of", "xstr", 0, xViewFirstIndexOf },
+	{ "view_first_index_of_ch", "xstr", 0, xViewFirstIndexOfCh },
+	{ "view_last_index_of", "xstr", 0, xViewLastIndexOf },
+	{ "view_last_index_of_ch", "xstr", 0, xViewLastIndexOfCh },
+	{ "view_compare", "xstr", 0, xViewCompare },
+	{ "view_case_compare", "xstr", 0, xViewCaseCompare },
+	{ "view_equal", "xstr", 0, xViewEqual },
+	{ "view_starts_with", "xstr", 0, xViewStartsWith },
+	{ "view_ends_with", "xstr", 0, xViewEndsWith },
+	{ "view_strip_front", "xstr", 0, xViewStripFront },
+	{ "view_strip_back", "xstr", 0, xViewStripBack },
+	{ "view_strip", "xstr", 0, xViewStrip },
+
+	{ "split_ch", "xstr", 0, xSplitCh },
+	{ "split_ch", "libc", 0, cSplitCh },
+	{ "split_str", "xstr", 0, xSplitStr },
+	{ "split_any", "xstr", 0, xSplitAny },
+	{ "split_any", "libc", 0, cSplitAny },
+	{ "join", "xstr", 0, xJoin },
+	{ "join", "libc", 0, cJoin },
+	{ "join_strs", "xstr", 0, xJoinStrs },
+	{ "append_views", "xstr", 0, xAppendViews },
+	{ "append_views", "libc", 0, cAppendViews },
+
+	{ "rope_append_len", "xstr", 0, xRopeAppendLen },
+	{ "rope_append_len", "libc", 0, cAppendLen },
+	{ "rope_insert_len", "xstr", FORMATTED, xRopeInsertLen },
+	{ "rope_insert_len", "libc", QUADRATIC, cInsertLen },
+	{ "gap_insert_len", "xstr", 0, xGapInsertLen },
+	{ "gap_insert_len", "libc", QUADRATIC, cInsertLen },
+	{ "gap_insert_ch", "xstr", 0, xGapInsertCh },
+
+	{ "map_set", "xstr", 0, xMapSet },
+	{ "map_get", "xstr", 0, xMapGet },
+	{ "intern", "xstr", 0, xIntern },
+	{ "intern_hit", "xstr", 0, xInternHit },
+	{ "list_append", "xstr", 0, xListAppend },
+	{ "list_append", "libc", 0, cAppendViews },
+	{ "list_sort", "xstr", 0, xListSort },
+	{ "list_sort", "libc", 0, cListSort },
+
+	{ "map_file", "xstr", 0, xMapFile },
+	{ "map_file", "libc", 0, cMapFile },
+	{ "read_records", "xstr", 0, xReadRecords },
+	{ "read_records", "libc", 0, cReadRecords },
+	{ "write_views", "xstr", 0, xWriteViews },
+	{ "write_views", "libc", 0, cWriteViews },
+	{ "write_strs", "xstr", 0, xWriteStrs },
+
+	{ "hash", "xstr", 0, xHash },
+	{ "hash_len", "xstr", 0, xHashLen },
+	{ "view_hash", "xstr", 0, xViewHash },
+};
+
+static const long sizes[] = {
+	8, 64, 512, 4096, 32768, 262144, 2097152, 16777216, 67108864
+};
+
+static void ctxInit(Ctx *c, xStrSize size)
+{
+	unsigned int seed = 12345;
+	c->size = size;
+	c->text = malloc(size + 1);
+	c->padded = malloc(size + 33);
+	if (!c->text || !c->padded) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	for (xStrSize i = 0; i < size; i++) {
+		seed = seed * 1103515245u + 12345u;
+		const unsigned int r = seed >> 16;
+		c->text[i] = (r % 32 == 0) ? ',' : 'a' + r % 16;
+	}
+	memcpy(c->text, "abcdefgh", (size < 8) ? size : 8);
+	memcpy(c->text + size - ((size < 8) ? size : 8), "abcdefgh", (size < 8) ? size : 8);
+	c->text[size] = '\0';
+	memset(c->padded, ' ', size + 32);
+	memcpy(c->padded + 16, c->text, size);
+	c->padded[size + 32] = '\0';
+
+	xStrInitLen(&c->a, c->text, size);
+	xStrInitLen(&c->b, c->text, size);
+	xStrArenaInit(&c->arena, 0);
+	xStrMapInit(&c->map);
+	xStrPoolInit(&c->pool);
+	c->path[0] = '\0';
+	c->buf.p = NULL;
+	c->buf.len = c->buf.cap = 0;
+	bufAppend(&c->buf, c->text, size);
+	c->sink = 0;
+
+	c->nparts = 0;
+	for (xStrSize i = 0; i < size; i++)
+		c->nparts += (c->text[i] == ',');
+	c->nparts++;
+	c->views = malloc(c->nparts * sizeof(xStrView));
+	c->strs = malloc(c->nparts * sizeof(xStr));
+	if (!c->views || !c->strs) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	xStrSplitIter it;
+	xStrSize n = 0;
+	xStrSplitInitCh(&it, xStrViewMake(c->text, size), ',');
+	while (xStrSplitNext(&it, &c->views[n])) {
+		xStrInitView(&c->strs[n], c->views[n]);
+		n++;
+	}
+}
+
+static void ctxCleanup(Ctx *c)
+{
+	for (xStrSize i = 0; i < c->nparts; i++)
+		xStrCleanup(&c->strs[i]);
+	free(c->strs);
+	free(c->views);
+	bufFree(&c->buf);
+	xStrMapCleanup(&c->map);
+	xStrPoolCleanup(&c->pool);
+	if (c->path[0])
+		unlink(c->path);
+	xStrArenaCleanup(&c->arena);
+	xStrCleanup(&c->b);
+	xStrCleanup(&c->a);
+	free(c->padded);
+	free(c->text);
+}
+
+// Doubles the iteration count until a batch takes at least MIN_TIME.
+static void runBench(const Bench *bench, xStrSize size)
+{
+	Ctx c;
+	ctxInit(&c, size);
+	bench->run(&c);
+
+	long iters = 1;
+	double elapsed;
+	for (;;) {
+		const double start = now();
+		for (long i = 0; i < iters; i++)
+			bench->run(&c);
+		elapsed = now() - start;
+		if (elapsed >= MIN_TIME)
+			break;
+		iters *= (elapsed > MIN_TIME / 64) ? 2 : 16;
+	}
+	const double ns = elapsed * 1e9 / iters;
+	printf("{\"bench\":\"%s\",\"impl\":\"%s\",\"size\":%ld,\"iters\":%ld,"
+		"\"ns_per_op\":%.1f,\"mb_per_s\":%.1f}\n",
+		bench->name, bench->impl, (long)size, iters, ns, size / ns * 1e3);
+	fflush(stdout);
+	ctxCleanup(&c);
+}
+
+int main(int argc, char **argv)
+{
+	const long maxSize = (argc > 1) ? atol(argv[1]) : LONG_MAX;
+	const char *filter = (argc > 2) ? argv[2] : NULL;
+
+	for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		const Bench *bench = &benches[i];
+		if (filter && !strstr(bench->name, filter))
+			continue;
+		for (size_t j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++) {
+			if (sizes[j] > maxSize || (bench->maxSize && sizes[j] > bench->maxSize))
+				break;
+			runBench(bench, sizes[j]);
+		}
+	}
+	return 0;
+}
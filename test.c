@@ -1,7 +1,19 @@
+#define _POSIX_C_SOURCE 200809L
 #include "xstr.h"
+#include "xstrgap.h"
+#include "xstrintern.h"
+#include "xstrio.h"
+#include "xstrlist.h"
+#include "xstrmap.h"
+#include "xstrrope.h"
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 static int strEqual(const char *s1, const char *s2)
 {
@@ -17,7 +29,7 @@ static int strEqual(const char *s1, const char *s2)
 
 static void printStr(const xStr *s)
 {
-	printf("Str: %s, len=%d, cap=%d\n", s->str, s->len, s->cap);
+	printf("Str: %s, len=%ld, cap=%ld\n", s->str, (long)s->len, (long)s->cap);
 	fflush(stdout);
 }
 
@@ -48,7 +60,7 @@ static void testCompact(xStr *s)
 	for (int i = 0; i < 100; i++)
 		xStrAppend(s, "abc");
 	assert(s->cap > (s->len + 1)); // oversized
-	int oldLen = s->len;
+	xStrSize oldLen = s->len;
 	xStrCompact(s);
 	assertLen(s, oldLen);
 	assert(s->cap == (s->len + 1)); // exact fit
@@ -59,7 +71,7 @@ static void testReserve(xStr *s)
 	xStrClear(s);
 	xStrCompact(s);
 	assertLen(s, 0);
-	assert(s->cap == (s->len + 1));
+	assert(s->cap == XSTR_INLINE_CAP); // compacted back into inline buffer
 	xStrReserve(s, 42);
 	assert(s->cap == 43);
 	for (int i = 0; i < s->len; i++)
@@ -68,6 +80,142 @@ static void testReserve(xStr *s)
 	assert(s->cap == 43);
 }
 
+static void testInline(xStr *s)
+{
+	xStr s2;
+	const char *longStr = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+	// short strings live inside the struct
+	xStrAssign(s, "abc");
+	xStrCompact(s);
+	assert(s->str == s->buf);
+	assert(s->cap == XSTR_INLINE_CAP);
+
+	// filling the inline buffer exactly stays inline
+	xStrClear(s);
+	for (int i = 0; i < XSTR_INLINE_CAP - 1; i++)
+		xStrAppendCh(s, 'x');
+	assert(s->str == s->buf);
+	assertLen(s, XSTR_INLINE_CAP - 1);
+
+	// growing spills to the heap, keeping contents
+	xStrAppendCh(s, 'y');
+	assert(s->str != s->buf);
+	assertLen(s, XSTR_INLINE_CAP);
+	assert(s->str[XSTR_INLINE_CAP - 1] == 'y');
+	assert(s->str[0] == 'x');
+	assertCap(s);
+
+	// shrinking and compacting moves back inline
+	xStrResize(s, 3);
+	xStrCompact(s);
+	assert(s->str == s->buf);
+	assertEq(s, "xxx");
+
+	// swapping inline with heap strings fixes up the pointers
+	xStrInit(&s2, longStr);
+	assert(s2.str != s2.buf);
+	xStrSwap(s, &s2);
+	assertEq(s, longStr);
+	assert(s->str != s->buf);
+	assertEq(&s2, "xxx");
+	assert(s2.str == s2.buf);
+	xStrSwap(s, &s2);
+	assertEq(s, "xxx");
+	assert(s->str == s->buf);
+	assertEq(&s2, longStr);
+
+	xStrCleanup(&s2);
+}
+
+static int allocCount;
+
+static void *countingAlloc(void *ctx, size_t size)
+{
+	(void)ctx;
+	allocCount++;
+	return malloc(size);
+}
+
+static void *countingRealloc(void *ctx, void *ptr, size_t oldSize, size_t newSize)
+{
+	(void)ctx;
+	(void)oldSize;
+	if (!ptr)
+		allocCount++;
+	return realloc(ptr, newSize);
+}
+
+static void countingFree(void *ctx, void *ptr, size_t size)
+{
+	(void)ctx;
+	(void)size;
+	if (ptr)
+		allocCount--;
+	free(ptr);
+}
+
+static void testAllocator(xStr *s)
+{
+	const xStrAllocator counting = {
+		countingAlloc, countingRealloc, countingFree, NULL
+	};
+	const char *longStr = "abcdefghijklmnopqrstuvwxyz0123456789";
+	xStr s2, s3;
+
+	// per-string allocator
+	allocCount = 0;
+	xStrInitAlloc(&s2, longStr, &counting);
+	assertEq(&s2, longStr);
+	assert(allocCount == 1);
+	xStrAppend(&s2, longStr);
+	xStrAppendFmt(&s2, "%d", 42);
+	assert(allocCount == 1);
+	xStrCleanup(&s2);
+	assert(allocCount == 0);
+
+	// global default only applies to strings initialized afterwards
+	xStrSetDefaultAllocator(&counting);
+	assert(xStrGetDefaultAllocator() == &counting);
+	xStrInit(&s2, longStr);
+	assert(allocCount == 1);
+	xStrSetDefaultAllocator(NULL);
+	xStrInit(&s3, longStr);
+	assert(allocCount == 1);
+
+	// moving a string to another allocator
+	xStrSetAllocator(&s2, NULL);
+	assert(allocCount == 0);
+	assertEq(&s2, longStr);
+	xStrSetAllocator(&s3, &counting);
+	assert(allocCount == 1);
+	xStrSwap(&s2, &s3);
+	xStrCleanup(&s2);
+	assert(allocCount == 0);
+	xStrCleanup(&s3);
+
+	// arena backed strings are released all at once
+	xStrArena arena;
+	xStrArenaInit(&arena, 64);
+	for (int round = 0; round < 3; round++) {
+		xStrInitAlloc(&s2, longStr, xStrArenaAllocator(&arena));
+		xStrInitAlloc(&s3, "", xStrArenaAllocator(&arena));
+		for (int i = 0; i < 100; i++) {
+			xStrAppend(&s2, "abc");
+			xStrAppendCh(&s3, 'x');
+		}
+		assertLen(&s2, (int)strlen(longStr) + 300);
+		assertLen(&s3, 100);
+		assert(strncmp(s2.str, longStr, strlen(longStr)) == 0);
+		assert(s3.str[99] == 'x');
+		assert(((size_t)xStrArenaAlloc(&arena, 3) % sizeof(void *)) == 0);
+		xStrArenaReset(&arena);
+	}
+	xStrArenaCleanup(&arena);
+
+	(void)s;
+}
+
 static void testResize(xStr *s)
 {
 	// resizing a 0 length string to zero length
@@ -217,6 +365,72 @@ static void testAppend(xStr *s)
 	assertLen(s, strlen("abcdef1234"));
 }
 
+static void testFormat(xStr *s)
+{
+	char longStr[600];
+	memset(longStr, 'x', sizeof(longStr) - 1);
+	longStr[sizeof(longStr) - 1] = '\0';
+
+	// appending within spare capacity
+	xStrAssign(s, "abc");
+	xStrReserve(s, 100);
+	xStrAppendFmt(s, "%d-%s", 42, "def");
+	assertEq(s, "abc42-def");
+	assertLen(s, strlen("abc42-def"));
+
+	// appending past capacity grows and retries
+	xStrAssign(s, "abc");
+	xStrCompact(s);
+	xStrAppendFmt(s, "%s", longStr);
+	assertLen(s, 3 + (int)strlen(longStr));
+	assert(strncmp(s->str, "abcxxx", 6) == 0);
+	assertCap(s);
+
+	// inserting a long format into the middle
+	xStrAssign(s, "abcdef");
+	xStrInsertFmt(s, 3, "<%s>", longStr);
+	assertLen(s, 8 + (int)strlen(longStr));
+	assert(strncmp(s->str, "abc<xxx", 7) == 0);
+	assert(strcmp(s->str + s->len - 5, "x>def") == 0);
+
+	// overwriting with a format
+	xStrAssign(s, "abc123ghi");
+	xStrOverwriteFmt(s, 3, 3, "%s", "def");
+	assertEq(s, "abcdefghi");
+	xStrOverwriteFmt(s, 6, -1, "%d", 789);
+	assertEq(s, "abcdef789");
+	assertLen(s, strlen("abcdef789"));
+
+	// inserting out of range leaves the string untouched
+	xStrInsertFmt(s, 42, "%d", 1);
+	assertEq(s, "abcdef789");
+
+	// empty format output
+	xStrAppendFmt(s, "%s", "");
+	assertEq(s, "abcdef789");
+	assertLen(s, strlen("abcdef789"));
+
+	// arguments taken from the string itself, growing and not
+	xStrAssign(s, "0123456789012345678901234567890123456789");
+	xStrCompact(s);
+	xStrAppendFmt(s, "-%s", s->str);
+	assertEq(s, "0123456789012345678901234567890123456789-0123456789012345678901234567890123456789");
+	xStrAssign(s, "abc");
+	xStrReserve(s, 100);
+	xStrAppendFmt(s, "-%s-%s", s->str, s->str);
+	assertEq(s, "abc-abc-abc");
+	xStrInsertFmt(s, 0, "%.3s|", s->str + 4);
+	assertEq(s, "abc|abc-abc-abc");
+
+	// the aliasing argument is found behind ones of every other type
+	xStrAssign(s, "abc");
+	xStrCompact(s);
+	xStrAppendFmt(s, "%%%-3d|%lld|%.1f|%*.*s|%c|%zu|%s|%s", 1, 2LL, 0.5, 3, 1, "zz",
+		'c', (size_t)4, longStr + 590, s->str);
+	assertEq(s, "abc%1  |2|0.5|  z|c|4|xxxxxxxxx|abc");
+	xStrAssign(s, "");
+}
+
 static void testErase(xStr *s)
 {
 	// erase at front
@@ -272,6 +486,21 @@ static void testOverwrite(xStr *s)
 	assertEq(s, "ABC123GHI");
 	assertLen(s, strlen("ABC123GHI"));
 
+	// same-sized overwrites happen in place, even from str itself or
+	// on a copy sharing the buffer
+	xStrOverwriteLen(s, 0, 3, s->str + 6, 3);
+	assertEq(s, "GHI123GHI");
+	xStrOverwriteFmt(s, 3, 3, "%.3s", s->str);
+	assertEq(s, "GHIGHIGHI");
+	xStr copy;
+	xStrAssign(s, "0123456789abcdefghijklmnopqrstuvwxyz");
+	xStrInitCopy(&copy, s);
+	xStrOverwriteCh(s, 35, 1, 'Z');
+	assertEq(s, "0123456789abcdefghijklmnopqrstuvwxyZ");
+	assertEq(&copy, "0123456789abcdefghijklmnopqrstuvwxyz");
+	xStrCleanup(&copy);
+	xStrAssign(s, "ABC123GHI");
+
 	// overwrite to end
 	xStrOverwrite(s, 3, -1, "");
 	assertEq(s, "ABC");
@@ -319,6 +548,55 @@ static void testReplace(xStr *s)
 	xStrReplace(s, "123", "XYZ", 0);
 	assertEq(s, "");
 	assertLen(s, 0);
+
+	// shorter replacement, in place
+	xStrAssign(s, "a--b--c----d");
+	xStrReplace(s, "--", "+", 0);
+	assertEq(s, "a+b+c++d");
+	assertLen(s, strlen("a+b+c++d"));
+
+	// empty replacement erases
+	xStrAssign(s, "xaxbxcx");
+	xStrReplace(s, "x", "", 0);
+	assertEq(s, "abc");
+	assertLen(s, strlen("abc"));
+
+	// longer replacement containing the needle is not rescanned
+	xStrAssign(s, "a.b.c");
+	xStrReplace(s, ".", "...", 0);
+	assertEq(s, "a...b...c");
+	assertLen(s, strlen("a...b...c"));
+
+	// longer replacement limited to the first two matches
+	xStrAssign(s, "a.b.c.d");
+	xStrReplace(s, ".", "<>", 2);
+	assertEq(s, "a<>b<>c.d");
+	assertLen(s, strlen("a<>b<>c.d"));
+
+	// growing in place within existing capacity
+	xStrAssign(s, "ab");
+	xStrReserve(s, 100);
+	xStrReplace(s, "b", "bbbb", 0);
+	assertEq(s, "abbbb");
+	assertLen(s, strlen("abbbb"));
+
+	// many matches, both growing and shrinking
+	xStrClear(s);
+	for (int i = 0; i < 1000; i++)
+		xStrAppend(s, "ab");
+	xStrReplace(s, "b", "xyz", 0);
+	assertLen(s, 4000);
+	assert(strncmp(s->str, "axyzaxyz", 8) == 0);
+	assert(strcmp(s->str + 3992, "axyzaxyz") == 0);
+	xStrReplace(s, "xyz", "", 0);
+	assertLen(s, 1000);
+	for (int i = 0; i < 1000; i++)
+		assert(s->str[i] == 'a');
+
+	// empty needle does nothing
+	xStrAssign(s, "abc");
+	xStrReplace(s, "", "x", 0);
+	assertEq(s, "abc");
 }
 
 static void testStripFront(xStr *s)
@@ -414,6 +692,27 @@ static void testCaseCompare(xStr *s)
 	assert(xStrCaseCompare(&s2, NULL) < 0);
 	assert(xStrCaseCompare(NULL, &s2) > 0);
 
+	// prefixes sort first
+	xStrAssign(s, "abc");
+	xStrAssign(&s2, "ABCD");
+	assert(xStrCaseCompare(s, &s2) < 0);
+	assert(xStrCaseCompare(&s2, s) > 0);
+
+	// long strings differing only in case, then past the vector width
+	xStrClear(s);
+	xStrClear(&s2);
+	for (int i = 0; i < 100; i++) {
+		xStrAppend(s, "Host-Name.Example:");
+		xStrAppend(&s2, "hOST-nAME.eXAMPLE:");
+	}
+	assert(xStrCaseCompare(s, &s2) == 0);
+	assert(xStrCaseCompareLocale(s, &s2) == 0);
+	s2.str[1000] = '@'; // sorts before any letter
+	assert(xStrCaseCompare(s, &s2) > 0);
+	assert(xStrCaseCompareLocale(s, &s2) > 0);
+	s2.str[1000] = '~';
+	assert(xStrCaseCompare(s, &s2) < 0);
+
 	xStrCleanup(&s2);
 }
 
@@ -447,6 +746,18 @@ static void testToUpper(xStr *s)
 	xStrClear(s);
 	xStrToUpper(s);
 	assertEq(s, "");
+
+	// long enough for the vector paths, with bytes around the letter ranges
+	xStrClear(s);
+	for (int i = 0; i < 10; i++)
+		xStrAppend(s, "@AZ[`az{\xe1\xc1 content-type: Text/HTML; ");
+	xStrToUpper(s);
+	for (int i = 0; i < s->len; i += s->len / 10)
+		assert(strncmp(s->str + i, "@AZ[`AZ{\xe1\xc1 CONTENT-TYPE: TEXT/HTML; ", s->len / 10) == 0);
+
+	xStrAssign(s, "a1b2C;");
+	xStrToUpperLocale(s);
+	assertEq(s, "A1B2C;");
 }
 
 static void testToLower(xStr *s)
@@ -457,6 +768,17 @@ static void testToLower(xStr *s)
 	xStrClear(s);
 	xStrToLower(s);
 	assertEq(s, "");
+
+	xStrClear(s);
+	for (int i = 0; i < 10; i++)
+		xStrAppend(s, "@AZ[`az{\xe1\xc1 Content-Type: Text/HTML; ");
+	xStrToLower(s);
+	for (int i = 0; i < s->len; i += s->len / 10)
+		assert(strncmp(s->str + i, "@az[`az{\xe1\xc1 content-type: text/html; ", s->len / 10) == 0);
+
+	xStrAssign(s, "A1B2c;");
+	xStrToLowerLocale(s);
+	assertEq(s, "a1b2c;");
 }
 
 static void testFirstIndexOf(xStr *s)
@@ -475,6 +797,1284 @@ static void testLastIndexOf(xStr *s)
 	assert(xStrLastIndexOfCh(s, 'c') == 5);
 	assert(xStrLastIndexOf(s, "z") == -1);
 	assert(xStrLastIndexOf(s, "") == -1);
+	assert(xStrLastIndexOf(s, "abc") == 3);
+	assert(xStrLastIndexOf(s, "cab") == 2);
+	assert(xStrLastIndexOf(s, "abcabc") == 0);
+	assert(xStrLastIndexOf(s, "abcabcd") == -1);
+
+	// long string, periodic needle, match only at the start
+	xStrAssign(s, "aaab");
+	for (int i = 0; i < 1000; i++)
+		xStrAppend(s, "aaaa");
+	assert(xStrLastIndexOf(s, "aaab") == 0);
+	assert(xStrLastIndexOf(s, "aab") == 1);
+	assert(xStrLastIndexOf(s, "aaaa") == s->len - 4);
+	assert(xStrLastIndexOf(s, "baaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa") == 3);
+	assert(xStrLastIndexOfCh(s, 'b') == 3);
+	assert(xStrLastIndexOfCh(s, 'a') == s->len - 1);
+	assert(xStrLastIndexOfCh(s, 'c') == -1);
+	assert(xStrLastIndexOf(s, "aaac") == -1);
+}
+
+static void testLimits(xStr *s)
+{
+	// requests that can't be represented are rejected without side effects
+	xStrAssign(s, "abc");
+	xStrReserve(s, XSTR_SIZE_MAX);
+	xStrResize(s, XSTR_SIZE_MAX);
+	xStrLeftJustify(s, XSTR_SIZE_MAX, ' ');
+	assertEq(s, "abc");
+	assertLen(s, 3);
+	assertCap(s);
+
+	// erasing with a huge length doesn't overflow the end position
+	xStrErase(s, 1, XSTR_SIZE_MAX);
+	assertEq(s, "a");
+	assertLen(s, 1);
+
+#ifdef XSTR_64BIT
+	assert(sizeof(xStrSize) == sizeof(ptrdiff_t));
+#else
+	assert(sizeof(xStrSize) == sizeof(int));
+#endif
+}
+
+static void testBinary(xStr *s)
+{
+	xStr s2;
+	static const char data[] = "ab\0cd\0ab\0";
+	const int dataLen = sizeof(data) - 1;
+
+	xStrAssignLen(s, data, dataLen);
+	assertLen(s, dataLen);
+	assert(memcmp(s->str, data, dataLen) == 0);
+
+	// searching past and for embedded NULs
+	assert(xStrFirstIndexOfCh(s, '\0') == 2);
+	assert(xStrLastIndexOfCh(s, '\0') == 8);
+	assert(xStrFirstIndexOf(s, "cd") == 3);
+	assert(xStrFirstIndexOfLen(s, "\0ab", 3) == 5);
+	assert(xStrLastIndexOfLen(s, "ab\0", 3) == 6);
+	assert(xStrFirstIndexOfLen(s, "d\0ab\0", 5) == 4);
+	assert(xStrFirstIndexOfLen(s, "d\0ac", 4) == -1);
+
+	// prefix and suffix checks compare the stored bytes
+	assert(xStrStartsWithLen(s, "ab\0c", 4));
+	assert(!xStrStartsWithLen(s, "ab\0d", 4));
+	assert(xStrEndsWithLen(s, "\0ab\0", 4));
+	assert(!xStrEndsWith(s, ""));
+	assert(!xStrEndsWith(s, "ab"));
+
+	// comparisons don't stop at NUL
+	xStrInitLen(&s2, data, dataLen);
+	assert(xStrEqual(s, &s2));
+	s2.str[4] = 'x';
+	assert(!xStrEqual(s, &s2));
+	assert(xStrCompare(s, &s2) < 0);
+	xStrAssignLen(&s2, data, 4);
+	assert(xStrCompare(&s2, s) < 0);
+	assert(xStrCaseCompare(&s2, s) < 0);
+
+	// replacing and stripping around NULs
+	xStrReplaceLen(s, "\0", 1, "-", 1, 0);
+	assertEq(s, "ab-cd-ab-");
+	assertLen(s, dataLen);
+	xStrAssignLen(s, "\0 ab \0", 7);
+	xStrStrip(s, NULL);
+	assertLen(s, 7);
+	xStrAssignLen(s, "  a\0b  ", 7);
+	xStrStrip(s, NULL);
+	assertLen(s, 3);
+	assert(memcmp(s->str, "a\0b", 4) == 0);
+
+	xStrCleanup(&s2);
+}
+
+static void testView(xStr *s)
+{
+	xStr s2;
+	xStrView v, w;
+
+	xStrAssign(s, "  key = value  ");
+	v = xStrViewOf(s);
+	assert(v.str == s->str && v.len == s->len);
+
+	// slicing clamps to the view
+	w = xStrViewSlice(v, 2, 3);
+	assert(w.len == 3 && memcmp(w.str, "key", 3) == 0);
+	w = xStrSlice(s, 8, -1);
+	assert(w.len == 7 && memcmp(w.str, "value  ", 7) == 0);
+	w = xStrViewSlice(v, 100, 5);
+	assert(w.len == 0);
+	w = xStrViewSlice(v, -5, 4);
+	assert(w.len == 4 && w.str == s->str);
+
+	// splitting a field without allocating
+	xStrSize eq = xStrViewFirstIndexOfCh(v, '=');
+	assert(eq == 6);
+	xStrView key = xStrViewStrip(xStrViewSlice(v, 0, eq), NULL);
+	xStrView val = xStrViewStrip(xStrViewSlice(v, eq + 1, -1), NULL);
+	assert(xStrViewEqual(key, xStrViewMake("key", -1)));
+	assert(xStrViewEqual(val, xStrViewMake("value", -1)));
+	assert(xStrViewCompare(key, val) < 0);
+	assert(xStrViewCaseCompare(xStrViewMake("VALUE", -1), val) == 0);
+	assert(xStrViewCompare(xStrViewMake("val", -1), val) < 0);
+	assert(xStrViewStripFront(v, NULL).len == 13);
+	assert(xStrViewStripBack(v, NULL).len == 13);
+	assert(xStrViewStripFront(xStrViewMake("xxx", -1), "x").len == 0);
+
+	// searching
+	v = xStrViewMake("a/b/c/d", -1);
+	assert(xStrViewFirstIndexOf(v, xStrViewMake("/", -1)) == 1);
+	assert(xStrViewLastIndexOf(v, xStrViewMake("/c", -1)) == 3);
+	assert(xStrViewLastIndexOfCh(v, '/') == 5);
+	assert(xStrViewFirstIndexOf(v, xStrViewMake("", -1)) == -1);
+	assert(xStrViewFirstIndexOfCh(v, 'x') == -1);
+	assert(xStrViewStartsWith(v, xStrViewMake("a/", -1)));
+	assert(xStrViewEndsWith(v, xStrViewMake("/d", -1)));
+	assert(!xStrViewEndsWith(v, xStrViewMake("/c", -1)));
+
+	// NULL makes an empty view
+	w = xStrViewMake(NULL, 5);
+	assert(w.len == 0 && w.str != NULL);
+
+	// converting back to strings
+	xStrInitView(&s2, xStrViewSlice(v, 2, 3));
+	assertEq(&s2, "b/c");
+	xStrAppendView(&s2, xStrViewMake("/d", -1));
+	assertEq(&s2, "b/c/d");
+	xStrInsertView(&s2, 0, xStrViewSlice(v, 0, 2));
+	assertEq(&s2, "a/b/c/d");
+	xStrAssignView(&s2, key);
+	assertEq(&s2, "key");
+	assertLen(&s2, 3);
+	xStrCleanup(&s2);
+}
+
+static int splitAll(xStrSplitIter *it, xStrView *fields, int max)
+{
+	int n = 0;
+	while (n < max && xStrSplitNext(it, &fields[n]))
+		n++;
+	return n;
+}
+
+#define assertView(v, s) assert(xStrViewEqual((v), xStrViewMake((s), -1)))
+
+static void testSplitJoin(xStr *s)
+{
+	xStrSplitIter it;
+	xStrView f[8];
+	xStr parts[3];
+
+	// by character, keeping empty fields
+	xStrAssign(s, "a,b,,c,");
+	xStrSplitInitCh(&it, xStrViewOf(s), ',');
+	assert(splitAll(&it, f, 8) == 5);
+	assertView(f[0], "a");
+	assertView(f[1], "b");
+	assertView(f[2], "");
+	assertView(f[3], "c");
+	assertView(f[4], "");
+	assert(f[0].str == s->str); // fields point into the source
+	assert(!xStrSplitNext(&it, &f[0]));
+
+	// empty input yields one empty field
+	xStrSplitInitCh(&it, xStrViewMake("", -1), ',');
+	assert(splitAll(&it, f, 8) == 1);
+	assert(f[0].len == 0);
+
+	// by string
+	xStrSplitInitStr(&it, xStrViewMake("GET /index.html HTTP/1.1\r\nHost: x\r\n", -1),
+		xStrViewMake("\r\n", -1));
+	assert(splitAll(&it, f, 8) == 3);
+	assertView(f[0], "GET /index.html HTTP/1.1");
+	assertView(f[1], "Host: x");
+	assertView(f[2], "");
+
+	// by any character of a set
+	xStrSplitInitAny(&it, xStrViewMake("a b\tc", -1), NULL);
+	assert(splitAll(&it, f, 8) == 3);
+	assertView(f[1], "b");
+	assertView(f[2], "c");
+
+	// joining views
+	xStrAssign(s, "old contents");
+	xStrJoin(s, xStrViewMake("/", -1), f, 3);
+	assertEq(s, "a/b/c");
+	assertLen(s, 5);
+	xStrJoin(s, xStrViewMake(", ", -1), f, 1);
+	assertEq(s, "a");
+	xStrJoin(s, xStrViewMake(", ", -1), f, 0);
+	assertEq(s, "");
+
+	// joining views of the destination itself
+	xStrAssign(s, "usr/local/lib/libxstr.a");
+	xStrSplitInitCh(&it, xStrViewOf(s), '/');
+	assert(splitAll(&it, f, 8) == 4);
+	f[3] = f[0];
+	xStrJoin(s, xStrViewMake("::", -1), f, 4);
+	assertEq(s, "usr::local::lib::usr");
+
+	// joining strings
+	xStrInit(&parts[0], "alpha");
+	xStrInit(&parts[1], "");
+	xStrInit(&parts[2], "a much longer part that will not fit inline");
+	xStrJoinStrs(s, xStrViewMake("|", -1), parts, 3);
+	assertEq(s, "alpha||a much longer part that will not fit inline");
+	for (int i = 0; i < 3; i++)
+		xStrCleanup(&parts[i]);
+}
+
+static unsigned int testRandom(void)
+{
+	static unsigned int seed = 12345;
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 16) & 0x7fff;
+}
+
+static void assertRopeEq(const xStrRope *rope, const xStr *expect, xStr *tmp)
+{
+	assert(xStrRopeLength(rope) == expect->len);
+	xStrRopeFlatten(rope, tmp);
+	assert(xStrEqual(tmp, expect));
+}
+
+static void testRope(xStr *s)
+{
+	xStrRope rope;
+	xStr expect;
+	char text[10000];
+	struct iovec iov[64];
+
+	for (int i = 0; i < (int)sizeof(text); i++)
+		text[i] = 'a' + (i % 26);
+
+	xStrRopeInit(&rope);
+	xStrInit(&expect, "");
+	assert(xStrRopeLength(&rope) == 0);
+	assert(xStrRopeSegments(&rope) == 0);
+
+	// appends fill chunks in place
+	for (int i = 0; i < 1000; i++) {
+		xStrRopeAppend(&rope, "0123456789");
+		xStrAppend(&expect, "0123456789");
+	}
+	assertRopeEq(&rope, &expect, s);
+	assert(xStrRopeSegments(&rope) < 10);
+	assert(xStrRopeCharAt(&rope, 12345 % 10000) == '5');
+	assert(xStrRopeCharAt(&rope, 10000) == '\0');
+
+	// random edits checked against a flat string
+	for (int i = 0; i < 2000; i++) {
+		xStrSize pos = testRandom() % (expect.len + 1);
+		xStrSize len = testRandom() % ((i % 10 == 0) ? sizeof(text) : 50);
+		if (testRandom() % 3 == 0) {
+			xStrRopeErase(&rope, pos, len);
+			xStrErase(&expect, pos, len);
+		} else {
+			xStrRopeInsertLen(&rope, pos, text, len);
+			xStrInsertLen(&expect, pos, text, len);
+		}
+		if (i % 100 == 0)
+			assertRopeEq(&rope, &expect, s);
+	}
+	assertRopeEq(&rope, &expect, s);
+
+	// small edits split full chunks in half and merge ones that run low,
+	// so every chunk but the last stays at least half full
+	for (int i = 0; i < 20; i++) {
+		xStrRopeAppendLen(&rope, text, sizeof(text));
+		xStrAppendLen(&expect, text, sizeof(text));
+	}
+	for (int i = 0; i < 20000; i++) {
+		xStrSize pos = testRandom() % (expect.len + 1);
+		xStrSize len = 1 + testRandom() % 8;
+		if (testRandom() % 2 == 0) {
+			xStrRopeErase(&rope, pos, len);
+			xStrErase(&expect, pos, len);
+		} else {
+			xStrRopeInsertLen(&rope, pos, text, len);
+			xStrInsertLen(&expect, pos, text, len);
+		}
+	}
+	assertRopeEq(&rope, &expect, s);
+	xStrSize segments = xStrRopeSegments(&rope);
+	for (xStrSize i = 0; i + 1 < segments; i++) {
+		assert(xStrRopeToIovec(&rope, i, iov, 1) == 1);
+		assert(iov[0].iov_len >= 2000 && iov[0].iov_len <= 4000);
+	}
+
+	// exporting the segments in batches
+	xStr joined;
+	xStrInit(&joined, "");
+	xStrSize first = 0, n;
+	while ((n = xStrRopeToIovec(&rope, first, iov, 64)) > 0) {
+		for (xStrSize i = 0; i < n; i++) {
+			assert(iov[i].iov_len > 0);
+			xStrAppendLen(&joined, iov[i].iov_base, iov[i].iov_len);
+		}
+		first += n;
+	}
+	assert(first == xStrRopeSegments(&rope));
+	assert(xStrEqual(&joined, &expect));
+	xStrCleanup(&joined);
+
+	// erasing everything
+	xStrRopeErase(&rope, 0, -1);
+	assert(xStrRopeLength(&rope) == 0);
+	assert(xStrRopeSegments(&rope) == 0);
+
+	// out of range edits are ignored
+	xStrRopeInsert(&rope, 1, "x");
+	xStrRopeErase(&rope, 0, 1);
+	assert(xStrRopeLength(&rope) == 0);
+
+	xStrRopeInsert(&rope, 0, "world");
+	xStrRopeInsert(&rope, 0, "hello ");
+	xStrRopeFlatten(&rope, s);
+	assertEq(s, "hello world");
+	xStrRopeClear(&rope);
+	assert(xStrRopeLength(&rope) == 0);
+
+	xStrRopeCleanup(&rope);
+	xStrCleanup(&expect);
+}
+
+static void testGap(xStr *s)
+{
+	xStrGap gap;
+	xStr expect;
+	const char text[] = "the quick brown fox jumps over the lazy dog";
+
+	// empty inserts never touch the unallocated buffer
+	xStrGapInit(&gap, "");
+	xStrGapInsertLen(&gap, 0, "", 0);
+	assert(xStrGapLength(&gap) == 0);
+	xStrGapCleanup(&gap);
+
+	xStrGapInit(&gap, "hello world");
+	xStrInit(&expect, "hello world");
+	assert(xStrGapLength(&gap) == 11);
+	assert(xStrGapCharAt(&gap, 4) == 'o');
+	assert(xStrGapCharAt(&gap, 11) == '\0');
+
+	// typing at a cursor leaves the gap behind the last character
+	xStrGapInsert(&gap, 5, ",");
+	xStrGapInsertCh(&gap, 6, '!');
+	assert(xStrGapCursor(&gap) == 7);
+	xStrGapErase(&gap, 6, 1);
+	xStrGapToStr(&gap, s);
+	assertEq(s, "hello, world");
+	xStrGapMoveTo(&gap, 0);
+	assert(xStrGapCursor(&gap) == 0);
+	assert(xStrGapCharAt(&gap, 5) == ',');
+	xStrGapErase(&gap, 5, 1);
+
+	// random local edits checked against a flat string
+	xStrSize cursor = 0;
+	for (int i = 0; i < 5000; i++) {
+		cursor += testRandom() % 9 - 4;
+		if (cursor < 0)
+			cursor = 0;
+		if (cursor > expect.len)
+			cursor = expect.len;
+		xStrSize len = testRandom() % ((i % 50 == 0) ? sizeof(text) : 4);
+		if (testRandom() % 3 == 0) {
+			xStrGapErase(&gap, cursor, len);
+			xStrErase(&expect, cursor, len);
+		} else {
+			xStrGapInsertLen(&gap, cursor, text, len);
+			xStrInsertLen(&expect, cursor, text, len);
+		}
+		assert(xStrGapLength(&gap) == expect.len);
+	}
+	xStrGapToStr(&gap, s);
+	assert(xStrEqual(s, &expect));
+	xStrGapCleanup(&gap);
+
+	// round trip through an xStr
+	xStrGapInitStr(&gap, &expect);
+	xStrGapErase(&gap, 0, -1);
+	assert(xStrGapLength(&gap) == 0);
+	xStrGapInsert(&gap, 0, "x");
+	xStrGapInsert(&gap, 5, "y");
+	xStrGapToStr(&gap, s);
+	assertEq(s, "x");
+	xStrGapCleanup(&gap);
+	xStrCleanup(&expect);
+}
+
+static void testHash(xStr *s)
+{
+	char buf[200];
+
+	// same bytes hash the same whatever holds them
+	xStrAssign(s, "content-length");
+	assert(xStrHash(s) == xStrViewHash(xStrViewMake("content-length", 14)));
+	assert(xStrHash(s) == xStrHashLen("content-length", 14, 0));
+	assert(xStrHash(s) != xStrHashLen("content-length", 14, 1));
+	assert(xStrHashLen("", 0, 0) == xStrHashLen(NULL, 0, 0));
+	assert(xStrHashSeed() != xStrHashSeed());
+
+	// every length and a flipped byte in every position changes the hash
+	for (int i = 0; i < (int)sizeof(buf); i++)
+		buf[i] = (char)(i * 7);
+	for (int len = 1; len < (int)sizeof(buf); len++) {
+		const uint64_t h = xStrHashLen(buf, len, 0);
+		assert(h != xStrHashLen(buf, len - 1, 0));
+		for (int i = 0; i < len; i += 5) {
+			buf[i] ^= 0x20;
+			assert(h != xStrHashLen(buf, len, 0));
+			buf[i] ^= 0x20;
+		}
+	}
+}
+
+static void testMap(xStr *s)
+{
+	xStrMap map;
+	char key[32];
+	int values[1000];
+
+	xStrMapInit(&map);
+	assert(xStrMapCount(&map) == 0);
+	assert(xStrMapGet(&map, xStrViewMake("missing", 7)) == NULL);
+	assert(!xStrMapRemove(&map, xStrViewMake("missing", 7)));
+
+	for (int i = 0; i < 1000; i++) {
+		values[i] = i;
+		int n = snprintf(key, sizeof(key), "key-%d", i);
+		assert(xStrMapSet(&map, xStrViewMake(key, n), &values[i]));
+	}
+	assert(xStrMapCount(&map) == 1000);
+	for (int i = 0; i < 1000; i++) {
+		int n = snprintf(key, sizeof(key), "key-%d", i);
+		int *v = xStrMapGet(&map, xStrViewMake(key, n));
+		assert(v && *v == i);
+	}
+
+	// the key is copied and matched on length, not on the terminator
+	xStrAssign(s, "key-1");
+	xStrMapEntry *e = xStrMapLookup(&map, xStrViewOf(s));
+	assert(e && e->keyLen == 5 && strcmp(e->key, "key-1") == 0);
+	assert(xStrMapGet(&map, xStrViewMake("key-12", 5)) == &values[1]);
+	assert(xStrMapGet(&map, xStrViewMake("key-1\0", 6)) == NULL);
+
+	// overwriting keeps one entry
+	assert(xStrMapSet(&map, xStrViewOf(s), &values[999]));
+	assert(xStrMapCount(&map) == 1000);
+	assert(xStrMapGet(&map, xStrViewOf(s)) == &values[999]);
+
+	// removing every other key leaves the rest reachable
+	for (int i = 0; i < 1000; i += 2) {
+		int n = snprintf(key, sizeof(key), "key-%d", i);
+		assert(xStrMapRemove(&map, xStrViewMake(key, n)));
+		assert(!xStrMapRemove(&map, xStrViewMake(key, n)));
+	}
+	assert(xStrMapCount(&map) == 500);
+	for (int i = 3; i < 1000; i += 2) {
+		int n = snprintf(key, sizeof(key), "key-%d", i);
+		int *v = xStrMapGet(&map, xStrViewMake(key, n));
+		assert(v && *v == i);
+	}
+
+	xStrSize pos = 0, seen = 0;
+	while ((e = xStrMapNext(&map, &pos)) != NULL)
+		seen++;
+	assert(seen == 500);
+
+	// empty keys are keys too
+	assert(xStrMapSet(&map, xStrViewMake("", 0), &values[0]));
+	assert(xStrMapGet(&map, xStrViewMake(NULL, 0)) == &values[0]);
+
+	// churning through distinct keys reclaims the removed ones and keeps
+	// the survivors intact
+	for (int i = 1000; i < 200000; i++) {
+		int n = snprintf(key, sizeof(key), "churn-%d", i);
+		assert(xStrMapSet(&map, xStrViewMake(key, n), &values[i % 1000]));
+		assert(xStrMapRemove(&map, xStrViewMake(key, n)));
+		assert(map.deadBytes <= map.liveBytes + 4096 + sizeof(key));
+	}
+	for (int i = 3; i < 1000; i += 2) {
+		int n = snprintf(key, sizeof(key), "key-%d", i);
+		e = xStrMapLookup(&map, xStrViewMake(key, n));
+		assert(e && *(int *)e->value == i && strcmp(e->key, key) == 0);
+	}
+
+	// every map hashes with its own seed
+	xStrMap other;
+	xStrMapInit(&other);
+	assert(other.seed != map.seed);
+	xStrMapCleanup(&other);
+
+	// keys come from the map's allocator, and a moved map keeps working
+	const xStrAllocator counting = {
+		countingAlloc, countingRealloc, countingFree, NULL
+	};
+	allocCount = 0;
+	xStrMapInitAlloc(&other, &counting);
+	for (int i = 0; i < 100; i++) {
+		int n = snprintf(key, sizeof(key), "moved-%d", i);
+		assert(xStrMapSet(&other, xStrViewMake(key, n), &values[i]));
+		if (i % 2)
+			assert(xStrMapRemove(&other, xStrViewMake(key, n)));
+	}
+	assert(allocCount >= 2);
+	xStrMap moved = other;
+	for (int i = 0; i < 100; i += 2) {
+		int n = snprintf(key, sizeof(key), "moved-%d", i);
+		assert(xStrMapGet(&moved, xStrViewMake(key, n)) == &values[i]);
+	}
+	xStrMapCleanup(&moved);
+	assert(allocCount == 0);
+
+	xStrMapClear(&map);
+	assert(xStrMapCount(&map) == 0);
+	assert(xStrMapGet(&map, xStrViewOf(s)) == NULL);
+	assert(xStrMapSet(&map, xStrViewOf(s), &values[1]));
+	assert(xStrMapGet(&map, xStrViewOf(s)) == &values[1]);
+	xStrMapCleanup(&map);
+}
+
+static xStrPool sharedPool;
+static const xStrInterned *sharedHandles[4][200];
+
+static void *internWorker(void *arg)
+{
+	const xStrInterned **handles = arg;
+	char name[32];
+	for (int round = 0; round < 20; round++) {
+		for (int i = 0; i < 200; i++) {
+			int n = snprintf(name, sizeof(name), "label_%d", i);
+			handles[i] = xStrIntern(&sharedPool, xStrViewMake(name, n));
+		}
+	}
+	return NULL;
+}
+
+static void testIntern(xStr *s)
+{
+	xStrPool pool;
+	xStrPoolInit(&pool);
+
+	// equal bytes give the same handle
+	xStrAssign(s, "content-type");
+	const xStrInterned *a = xStrInternStr(&pool, s);
+	const xStrInterned *b = xStrIntern(&pool, xStrViewMake("content-type", -1));
+	const xStrInterned *c = xStrIntern(&pool, xStrViewMake("content-typeX", 12));
+	const xStrInterned *d = xStrIntern(&pool, xStrViewMake("content-length", -1));
+	assert(a && a == b && a == c && a != d);
+	assert(a->len == 12 && strcmp(a->str, "content-type") == 0);
+	assert(xStrViewEqual(xStrInternedView(d), xStrViewMake("content-length", -1)));
+	assert(xStrPoolCount(&pool) == 2);
+
+	// embedded NULs are part of the key
+	const xStrInterned *e = xStrIntern(&pool, xStrViewMake("a\0b", 3));
+	assert(e != xStrIntern(&pool, xStrViewMake("a\0c", 3)));
+	assert(e == xStrIntern(&pool, xStrViewMake("a\0b", 3)));
+	assert(xStrIntern(&pool, xStrViewMake("", 0)) == xStrIntern(&pool, xStrViewMake(NULL, 0)));
+
+	// lookups don't add, and handles survive the table growing
+	assert(xStrPoolLookup(&pool, xStrViewMake("nope", -1)) == NULL);
+	for (int i = 0; i < 5000; i++) {
+		xStrAssignFmt(s, "field%d", i % 1000);
+		xStrInternStr(&pool, s);
+	}
+	assert(xStrPoolCount(&pool) == 1005);
+	assert(xStrPoolLookup(&pool, xStrViewMake("content-type", -1)) == a);
+	assert(strcmp(a->str, "content-type") == 0);
+	xStrPoolCleanup(&pool);
+
+	// handles come from the pool's allocator, and a moved pool keeps working
+	const xStrAllocator counting = {
+		countingAlloc, countingRealloc, countingFree, NULL
+	};
+	allocCount = 0;
+	xStrPoolInitAlloc(&pool, &counting);
+	a = xStrIntern(&pool, xStrViewMake("content-type", -1));
+	assert(allocCount >= 2);
+	xStrPool moved = pool;
+	assert(xStrIntern(&moved, xStrViewMake("content-type", -1)) == a);
+	xStrPoolCleanup(&moved);
+	assert(allocCount == 0);
+
+	// a shared pool hands every thread the same handles
+	pthread_t threads[4];
+	assert(xStrPoolInitShared(&sharedPool));
+	for (int t = 0; t < 4; t++)
+		assert(pthread_create(&threads[t], NULL, internWorker, sharedHandles[t]) == 0);
+	for (int t = 0; t < 4; t++)
+		pthread_join(threads[t], NULL);
+	assert(xStrPoolCount(&sharedPool) == 200);
+	for (int t = 1; t < 4; t++)
+		assert(memcmp(sharedHandles[t], sharedHandles[0], sizeof(sharedHandles[0])) == 0);
+	xStrPoolCleanup(&sharedPool);
+}
+
+static void testList(xStr *s)
+{
+	xStrList list;
+	xStr strs[6];
+	const char *words[] = { "pear", "apple", "fig", "apple", "", "fig" };
+
+	xStrListInit(&list);
+	assert(xStrListCount(&list) == 0);
+	assert(xStrListGet(&list, 0).len == 0);
+	for (int i = 0; i < 6; i++)
+		xStrListAppend(&list, words[i]);
+	xStrListAppendLen(&list, "a\0b", 3);
+	assert(xStrListCount(&list) == 7);
+	assert(xStrListBytes(&list) == 4 + 5 + 3 + 5 + 0 + 3 + 3);
+	assert(xStrViewEqual(xStrListGet(&list, 1), xStrViewMake("apple", -1)));
+	assert(xStrListGet(&list, 4).len == 0);
+	assert(memcmp(xStrListGet(&list, 6).str, "a\0b", 3) == 0);
+	assert(xStrListGet(&list, 7).len == 0);
+	assert(xStrListGet(&list, -1).len == 0);
+
+	// sorting packs the blob in order, dedup then keeps one of each
+	xStrListSort(&list);
+	xStrListDedup(&list);
+	assert(xStrListCount(&list) == 5);
+	const xStrView sorted[] = {
+		{ "", 0 }, { "a\0b", 3 }, { "apple", 5 }, { "fig", 3 }, { "pear", 4 }
+	};
+	for (int i = 0; i < 5; i++)
+		assert(xStrViewEqual(xStrListGet(&list, i), sorted[i]));
+	assert(xStrListBytes(&list) == 3 + 5 + 3 + 4);
+	assert(memcmp(xStrListGet(&list, 0).str, "a\0bapplefigpear", 15) == 0);
+
+	// round trip through individual strings
+	xStrListToStrs(&list, strs);
+	assertEq(&strs[2], "apple");
+	assertLen(&strs[1], 3);
+	xStrListClear(&list);
+	assert(xStrListCount(&list) == 0);
+	xStrListFromStrs(&list, strs, 5);
+	xStrListFromStrs(&list, strs, 5);
+	assert(xStrListCount(&list) == 10);
+	assert(xStrViewEqual(xStrListGet(&list, 9), xStrViewOf(&strs[4])));
+	for (int i = 0; i < 5; i++)
+		xStrCleanup(&strs[i]);
+
+	// many small items share one blob
+	xStrListClear(&list);
+	for (int i = 0; i < 10000; i++) {
+		xStrAssignFmt(s, "%d", (i * 7919) % 1000);
+		xStrListAppendView(&list, xStrViewOf(s));
+	}
+	xStrListSort(&list);
+	for (xStrSize i = 1; i < xStrListCount(&list); i++)
+		assert(xStrViewCompare(xStrListGet(&list, i - 1), xStrListGet(&list, i)) <= 0);
+	xStrListDedup(&list);
+	assert(xStrListCount(&list) == 1000);
+	xStrListCleanup(&list);
+}
+
+#ifdef XSTR_STATS
+static void *statsWorker(void *arg)
+{
+	xStr s;
+	(void)arg;
+	xStrInit(&s, "");
+	xStrResize(&s, 1000);
+	xStrCleanup(&s);
+	return NULL;
+}
+
+static void testStats(xStr *s)
+{
+	xStrStats st;
+	xStr t;
+	(void)s;
+
+	xStrStatsReset();
+	xStrStatsSnapshot(&st);
+	assert(st.total.allocs == 0 && st.total.bytesCopied == 0);
+
+	// leaving the inline buffer allocates, then capacity doubles
+	xStrInit(&t, "");
+	for (int i = 0; i < 100; i++)
+		xStrAppendCh(&t, 'x');
+	xStrStatsSnapshot(&st);
+	assert(st.site[XSTR_SITE_INSERT].allocs == 1);
+	assert(st.site[XSTR_SITE_INSERT].reallocs == 2);
+	assert(st.site[XSTR_SITE_INSERT].bytesAllocated == 48 + 96 + 192);
+	assert(st.site[XSTR_SITE_INSERT].bytesSlack == (48 - 25) + (96 - 49) + (192 - 97));
+	assert(st.site[XSTR_SITE_INSERT].bytesCopied == 24 + 100);
+	assert(st.total.allocs == 1 && st.total.reallocs == 2);
+
+	// the outermost call is charged for the work it delegates
+	xStrStatsReset();
+	xStrAssignFmt(&t, "%0200d", 7);
+	xStrInsertLen(&t, 0, "abc", 3);
+	xStrErase(&t, 0, 3);
+	xStrStatsSnapshot(&st);
+	assert(st.site[XSTR_SITE_ASSIGN].reallocs == 1);
+	assert(st.site[XSTR_SITE_FORMAT].reallocs == 0);
+	assert(st.site[XSTR_SITE_INSERT].bytesCopied == 200 + 3);
+	assert(st.site[XSTR_SITE_ERASE].bytesCopied == 200);
+
+	// formats are written in place unless a %s argument comes from the
+	// string, however long or full of other letters they are
+	xStrStatsReset();
+	xStrAppendFmt(&t, "requests=%d\n", 7);
+	xStrAppendFmt(&t, "%s %s", "status", "x");
+	char line[300];
+	memset(line, 'y', sizeof(line) - 1);
+	line[sizeof(line) - 1] = '\0';
+	xStrAppendFmt(&t, "%s", line);
+	xStrStatsSnapshot(&st);
+	assert(st.site[XSTR_SITE_INSERT].bytesCopied == 0);
+	assert(st.site[XSTR_SITE_FORMAT].bytesCopied == 0);
+	xStrAppendFmt(&t, "%s", t.str + t.len - 4);
+	xStrStatsSnapshot(&st);
+	assert(st.total.bytesCopied >= 4);
+	xStrCompact(&t);
+	xStrCleanup(&t);
+	xStrStatsSnapshot(&st);
+	assert(st.site[XSTR_SITE_COMPACT].reallocs == 1);
+	assert(st.site[XSTR_SITE_INIT].frees == 1);
+	assert(strcmp(xStrStatSiteName(XSTR_SITE_COMPACT), "compact") == 0);
+
+	// counters are per thread
+	pthread_t thread;
+	xStrStatsReset();
+	assert(pthread_create(&thread, NULL, statsWorker, NULL) == 0);
+	pthread_join(thread, NULL);
+	xStrStatsSnapshot(&st);
+	assert(st.total.allocs == 0 && st.total.frees == 0);
+}
+#endif
+
+static void testGrowth(xStr *s)
+{
+	xStrGrowth exact = { XSTR_GROW_EXACT, 0, 0, 0 };
+	xStrGrowth half = { XSTR_GROW_HALF, 0, 0, 0 };
+	xStrGrowth fixed = { XSTR_GROW_FIXED, 100, 0, 0 };
+	xStrGrowth usable = { XSTR_GROW_EXACT, 0, 1, 0 };
+	xStrGrowth shrink = { XSTR_GROW_DOUBLE, 0, 0, 4 };
+	xStr t;
+
+	assert(xStrGetDefaultGrowth()->kind == XSTR_GROW_DOUBLE);
+
+	xStrSetDefaultGrowth(&exact);
+	xStrInit(&t, "");
+	for (int i = 0; i < 30; i++)
+		xStrAppendCh(&t, 'x');
+	assert(t.cap == 31);
+	xStrCleanup(&t);
+
+	xStrSetDefaultGrowth(&half);
+	xStrInit(&t, "");
+	for (int i = 0; i < 40; i++)
+		xStrAppendCh(&t, 'x');
+	assert(t.cap == XSTR_INLINE_CAP * 3 / 2 * 3 / 2);
+	xStrCleanup(&t);
+
+	xStrSetDefaultGrowth(&fixed);
+	xStrInit(&t, "");
+	xStrResize(&t, 150);
+	assert(t.cap == 151);
+	xStrAppendCh(&t, 'x');
+	assert(t.cap == 251);
+	xStrCleanup(&t);
+
+	// the capacity covers the whole block, so filling it doesn't move it
+	xStrSetDefaultGrowth(&usable);
+	xStrInit(&t, "");
+	xStrReserve(&t, 30);
+	assert(t.cap >= 31);
+	const char *p = t.str;
+	while (t.len < t.cap - 1)
+		xStrAppendCh(&t, 'x');
+	assert(t.str == p);
+	xStrCleanup(&t);
+
+	// shrinks once len falls well below cap, leaving room to grow again
+	xStrSetDefaultGrowth(&shrink);
+	xStrInit(&t, "");
+	xStrReserve(&t, 1000);
+	xStrResize(&t, 300);
+	assert(t.cap == 1001);
+	xStrResize(&t, 100);
+	assert(t.cap == 202);
+	xStrErase(&t, 10, -1);
+	assert(t.cap == XSTR_INLINE_CAP && t.str == t.buf);
+	xStrAssign(&t, "0123456789012345678901234567890123456789");
+	xStrAssign(&t, "short");
+	assertEq(&t, "short");
+	assert(t.str == t.buf);
+	xStrCleanup(&t);
+
+	xStrSetDefaultGrowth(NULL);
+	assert(xStrGetDefaultGrowth()->kind == XSTR_GROW_DOUBLE);
+	xStrAssign(s, "");
+}
+
+static int releaseCount;
+
+static void countRelease(void *ctx, const char *data, xStrSize len)
+{
+	assert(ctx == &releaseCount && len == 5 && memcmp(data, "fixed", 6) == 0);
+	releaseCount++;
+}
+
+static void *dropCopies(void *arg)
+{
+	xStr *copies = arg;
+	for (int i = 0; i < 4; i++)
+		xStrCleanup(&copies[i]);
+	return NULL;
+}
+
+static void testCopy(xStr *s)
+{
+	const char *text = "copied without copying the bytes";
+	xStr a, b, c;
+
+	// copies share the buffer until one of them changes
+	xStrInit(&a, text);
+	xStrInitCopy(&b, &a);
+	xStrInitCopy(&c, &b);
+	assert(b.str == a.str && c.str == a.str);
+	assert(xStrIsShared(&a) && xStrIsShared(&c));
+	// they report no room of their own, and reserving what the buffer
+	// already holds keeps sharing it
+	assert(a.cap == 0 && c.cap == 0);
+	xStrReserve(&c, 8);
+	assert(c.str == a.str);
+	xStrAppendCh(&b, '!');
+	assert(b.str != a.str && !xStrIsShared(&b));
+	assertEq(&a, text);
+	assertEq(&b, "copied without copying the bytes!");
+	xStrToUpper(&c);
+	assertEq(&c, "COPIED WITHOUT COPYING THE BYTES");
+	assertEq(&a, text);
+	assert(!xStrIsShared(&a));
+
+	// the last holder takes the buffer back without copying it
+	xStrCopy(&b, &a);
+	const char *p = a.str;
+	xStrCleanup(&a);
+	xStrErase(&b, 6, -1);
+	assertEq(&b, "copied");
+	assert(b.str == p && b.cap > 0);
+
+	// every kind of edit leaves the other copies alone
+	xStrInit(&a, text);
+	xStrCopy(&b, &a);
+	xStrReplace(&b, "copy", "dupe", 0);
+	xStrCopy(&c, &a);
+	xStrStrip(&c, "cs");
+	assertEq(&b, "copied without dupeing the bytes");
+	assertEq(&c, "opied without copying the byte");
+	xStrCopy(&b, &a);
+	xStrResize(&b, 4);
+	xStrCopy(&c, &a);
+	xStrRightJustify(&c, 40, '.');
+	assertEq(&b, "copi");
+	assertLen(&c, 40);
+	xStrCopy(&b, &a);
+	xStrClear(&b);
+	xStrCopy(&c, &a);
+	xStrAppendFmt(&c, "%d", 42);
+	assertEq(&b, "");
+	assert(xStrEndsWith(&c, "bytes42"));
+	assertEq(&a, text);
+
+	// short strings are simply copied
+	xStrAssign(&b, "inline");
+	xStrCopy(&c, &b);
+	assert(c.str != b.str && c.cap > 0);
+	assertEq(&c, "inline");
+
+	// external buffers are read-only and released by the last holder
+	releaseCount = 0;
+	xStrCleanup(&b);
+	xStrInitExternal(&b, "fixed", 5, countRelease, &releaseCount);
+	assertEq(&b, "fixed");
+	xStrCopy(&c, &b);
+	xStrAppend(&b, " up");
+	assertEq(&b, "fixed up");
+	assert(releaseCount == 0);
+	xStrCleanup(&c);
+	assert(releaseCount == 1);
+
+	// copies can be dropped from other threads
+	xStr copies[2][4];
+	pthread_t threads[2];
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 4; j++)
+			xStrInitCopy(&copies[i][j], &a);
+		pthread_create(&threads[i], NULL, dropCopies, copies[i]);
+	}
+	for (int i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+	assert(!xStrIsShared(&a));
+	assertEq(&a, text);
+
+	xStrCleanup(&a);
+	xStrCleanup(&b);
+	xStrAssign(s, "");
+}
+
+// Creates an empty file of its own under $TMPDIR, so test binaries run side
+// by side don't clobber each other's files.
+static void tempFile(char *path, size_t size)
+{
+	const char *dir = getenv("TMPDIR");
+	snprintf(path, size, "%s/xstrio-test-XXXXXX", (dir && *dir) ? dir : "/tmp");
+	const int fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+}
+
+static void writeFile(const char *path, const char *data, size_t len)
+{
+	FILE *fp = fopen(path, "wb");
+	assert(fp);
+	assert(fwrite(data, 1, len, fp) == len);
+	assert(fclose(fp) == 0);
+}
+
+// Writes the held string into a pipe and closes it, so the reading end sees
+// a stream of unknown length.
+struct pipeFeed {
+	int fd;
+	const xStr *data;
+};
+
+static void *feedPipe(void *arg)
+{
+	struct pipeFeed *feed = arg;
+	const char *p = feed->data->str;
+	size_t left = feed->data->len;
+	while (left > 0) {
+		const ssize_t n = write(feed->fd, p, left);
+		assert(n > 0);
+		p += n;
+		left -= n;
+	}
+	close(feed->fd);
+	return NULL;
+}
+
+static void testMapFile(xStr *s)
+{
+	char path[256];
+	xStr t, u;
+
+	tempFile(path, sizeof(path));
+
+	// small files are read rather than mapped
+	xStrAssign(s, "line one\nline two\n");
+	writeFile(path, s->str, s->len);
+	assert(xStrMapFile(&t, path, XSTR_MAP_SEQUENTIAL));
+	assert(xStrEqual(&t, s) && t.cap > 0);
+	xStrCleanup(&t);
+
+	// a file ending on a page boundary is still terminated
+	xStrResize(s, 65536);
+	memset(s->str, 'x', s->len);
+	writeFile(path, s->str, s->len);
+	assert(xStrMapFile(&t, path, XSTR_MAP_RANDOM));
+	assert(t.cap == 0 && xStrEqual(&t, s) && t.str[t.len] == '\0');
+
+	// changes go to a private copy, never to the file
+	xStrInitCopy(&u, &t);
+	xStrOverwriteCh(&u, 0, 1, 'y');
+	assert(u.str[0] == 'y' && t.str[0] == 'x');
+	xStrCleanup(&t);
+	xStrCleanup(&u);
+	assert(xStrMapFile(&t, path, XSTR_MAP_NORMAL));
+	assert(t.cap == 0 && xStrEqual(&t, s));
+	xStrCleanup(&t);
+
+	writeFile(path, "", 0);
+	assert(xStrMapFile(&t, path, XSTR_MAP_NORMAL));
+	assertEq(&t, "");
+	xStrCleanup(&t);
+
+	// a pipe can't be mapped and is read in full instead
+	int fds[2];
+	char name[32];
+	pthread_t thread;
+	xStrResize(s, 1 << 20);
+	for (xStrSize i = 0; i < s->len; i++)
+		s->str[i] = (char)('a' + i % 23);
+	assert(pipe(fds) == 0);
+	struct pipeFeed feed = { fds[1], s };
+	assert(pthread_create(&thread, NULL, feedPipe, &feed) == 0);
+	snprintf(name, sizeof(name), "/dev/fd/%d", fds[0]);
+	assert(xStrMapFile(&t, name, XSTR_MAP_SEQUENTIAL));
+	pthread_join(thread, NULL);
+	close(fds[0]);
+	assert(xStrEqual(&t, s) && t.str[t.len] == '\0');
+	xStrCleanup(&t);
+
+	assert(remove(path) == 0);
+	errno = 0;
+	assert(!xStrMapFile(&t, path, XSTR_MAP_NORMAL));
+	assert(errno == ENOENT);
+	assertEq(&t, "");
+	xStrCleanup(&t);
+	xStrAssign(s, "");
+}
+
+static void testReader(xStr *s)
+{
+	char path[256];
+	xStrReader reader;
+	xStrView v;
+	xStr t;
+
+	tempFile(path, sizeof(path));
+
+	// a record much longer than the buffer sits between short ones
+	xStrAssign(s, "alpha\nbeta\n\n");
+	for (int i = 0; i < 200000; i++)
+		xStrAppendCh(s, 'a' + i % 26);
+	xStrAppend(s, "\ngamma,delta");
+	writeFile(path, s->str, s->len);
+
+	int fd = open(path, O_RDONLY);
+	assert(fd >= 0);
+	xStrReaderInit(&reader, fd);
+	assert(xStrReaderNext(&reader, '\n', &v) == 1);
+	assert(xStrViewEqual(v, xStrViewMake("alpha", -1)));
+	assert(xStrReaderNext(&reader, '\n', &v) == 1);
+	assert(xStrViewEqual(v, xStrViewMake("beta", -1)));
+	assert(xStrReaderNext(&reader, '\n', &v) == 1 && v.len == 0);
+	assert(xStrReaderNext(&reader, '\n', &v) == 1);
+	assert(v.len == 200000 && v.str[0] == 'a' && v.str[199999] == 'a' + 199999 % 26);
+	assert(xStrReaderNext(&reader, ',', &v) == 1);
+	assert(xStrViewEqual(v, xStrViewMake("gamma", -1)));
+	assert(xStrReaderNext(&reader, ',', &v) == 1);
+	assert(xStrViewEqual(v, xStrViewMake("delta", -1)));
+	assert(xStrReaderNext(&reader, ',', &v) == 0);
+	xStrReaderCleanup(&reader);
+	close(fd);
+
+	// the same records assigned to a string, keeping its capacity
+	fd = open(path, O_RDONLY);
+	assert(fd >= 0);
+	xStrReaderInit(&reader, fd);
+	xStrInit(&t, NULL);
+	xStrReserve(&t, 300000);
+	const char *p = t.str;
+	assert(xStrReaderNextStr(&reader, '\n', &t) == 1);
+	assertEq(&t, "alpha");
+	assert(xStrReaderNextStr(&reader, '\n', &t) == 1);
+	assertEq(&t, "beta");
+	assert(xStrReaderNextStr(&reader, '\n', &t) == 1);
+	assertEq(&t, "");
+	assert(xStrReaderNextStr(&reader, '\n', &t) == 1);
+	assert(t.len == 200000 && xStrViewEqual(xStrViewOf(&t), xStrSlice(s, 12, 200000)));
+	assert(xStrReaderNextStr(&reader, '\n', &t) == 1);
+	assertEq(&t, "gamma,delta");
+	assert(xStrReaderNextStr(&reader, '\n', &t) == 0);
+	assert(t.str == p);
+	xStrReaderCleanup(&reader);
+	close(fd);
+
+	xStrReaderInit(&reader, -1);
+	errno = 0;
+	assert(xStrReaderNextStr(&reader, '\n', &t) == -1 && errno == EBADF);
+	xStrReaderCleanup(&reader);
+
+	assert(remove(path) == 0);
+	xStrCleanup(&t);
+	xStrAssign(s, "");
+}
+
+static void testWriter(xStr *s)
+{
+	char path[256];
+	xStrWriter writer;
+	xStr big, t;
+
+	tempFile(path, sizeof(path));
+
+	xStrInit(&big, NULL);
+	for (int i = 0; i < 1000; i++)
+		xStrAppendCh(&big, 'A' + i % 26);
+
+	for (int async = 0; async < 2; async++) {
+		int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		assert(fd >= 0);
+		if (async)
+			assert(xStrWriterInitAsync(&writer, fd));
+		else
+			xStrWriterInit(&writer, fd);
+
+		// enough pieces for several batches, checked against a plain copy
+		xStrAssign(s, "");
+		for (int i = 0; i < 300; i++) {
+			xStrInit(&t, NULL);
+			xStrAppendFmt(&t, "%d,", i);
+			assert(xStrWriterAdd(&writer, &t));
+			xStrAppendLen(s, t.str, t.len);
+			xStrCleanup(&t);
+			if (i % 7 == 0) {
+				assert(xStrWriterAdd(&writer, &big));
+				xStrAppendLen(s, big.str, big.len);
+				// the writer keeps what was added, not what big becomes
+				xStrOverwriteCh(&big, 0, 1, 'a' + i % 26);
+			}
+			if (i % 50 == 0) {
+				assert(xStrWriterAddView(&writer, xStrViewMake("|", 1)));
+				xStrAppendCh(s, '|');
+			}
+		}
+		assert(xStrWriterAddLen(&writer, NULL, -1));
+		assert(xStrWriterFlush(&writer));
+		xStrWriterCleanup(&writer);
+		close(fd);
+
+		assert(xStrMapFile(&t, path, XSTR_MAP_NORMAL));
+		assert(xStrEqual(&t, s));
+		xStrCleanup(&t);
+	}
+
+	// errors stick
+	xStrWriterInit(&writer, -1);
+	assert(xStrWriterAddLen(&writer, "lost", -1));
+	errno = 0;
+	assert(!xStrWriterFlush(&writer) && errno == EBADF);
+	errno = 0;
+	assert(!xStrWriterAddLen(&writer, "lost", -1) && errno == EBADF);
+	xStrWriterCleanup(&writer);
+
+	assert(remove(path) == 0);
+	xStrCleanup(&big);
+	xStrAssign(s, "");
+}
+
+static void testConcat(xStr *s)
+{
+	xStrConcat(s, "user:", "42", ":", "profile", NULL);
+	assertEq(s, "user:42:profile");
+	xStrAppendMany(s, NULL);
+	xStrAppendMany(s, ":", "", "v2", NULL);
+	assertEq(s, "user:42:profile:v2");
+
+	// grows once, straight to the size needed
+	xStrAssign(s, "");
+	xStrCompact(s);
+	xStrAppendMany(s, "0123456789012345678901234567890123456789",
+		"0123456789012345678901234567890123456789", "0123456789", NULL);
+	assertLen(s, 90);
+	assert(s->cap == 91);
+
+	// parts from the string itself survive it moving
+	xStrAssign(s, "abc");
+	xStrCompact(s);
+	xStrAppendMany(s, s->str, "-", s->str, "0123456789012345678901234567890123456789", NULL);
+	assertEq(s, "abcabc-abc0123456789012345678901234567890123456789");
+
+	// long lists grow once too, and still read parts from the old buffer
+	xStrAssign(s, "");
+	xStrAppendMany(s, "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k",
+		"l", "m", "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y",
+		"z", "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", NULL);
+	assertEq(s, "abcdefghijklmnopqrstuvwxyz0123456789");
+	xStrCompact(s);
+	xStrAppendMany(s, "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k",
+		"l", "m", "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y",
+		"z", "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", s->str + 26, NULL);
+	assertLen(s, 82);
+	assert(s->cap == 83);
+	assert(memcmp(s->str + 36, s->str, 36) == 0);
+	assertEq(s, "abcdefghijklmnopqrstuvwxyz0123456789"
+		"abcdefghijklmnopqrstuvwxyz0123456789" "0123456789");
+	xStrResize(s, 36);
+
+	xStrView parts[] = {
+		xStrViewMake("key", -1), xStrViewMake("a\0b", 3), xStrSlice(s, 0, 3)
+	};
+	xStrAppendViews(s, parts, 3);
+	assertLen(s, 45);
+	assert(memcmp(s->str + 36, "keya\0babc", 9) == 0);
+	xStrAppendViews(s, parts, 0);
+	assertLen(s, 45);
+	xStrAssign(s, "");
+}
+
+static void testAppendNumber(xStr *s)
+{
+	xStrAssign(s, "");
+	xStrAppendInt(s, 0);
+	xStrAppendCh(s, ' ');
+	xStrAppendInt(s, -42);
+	xStrAppendCh(s, ' ');
+	xStrAppendInt(s, LLONG_MIN);
+	xStrAppendCh(s, ' ');
+	xStrAppendUInt(s, ULLONG_MAX);
+	xStrAppendCh(s, ' ');
+	xStrAppendHex(s, 0);
+	xStrAppendCh(s, ' ');
+	xStrAppendHex(s, 0xdeadbeefull);
+	xStrAppendCh(s, ' ');
+	xStrAppendHex(s, ULLONG_MAX);
+	assertEq(s, "0 -42 -9223372036854775808 18446744073709551615 0 deadbeef ffffffffffffffff");
+
+	// every digit count against printf
+	char buf[48];
+	for (unsigned long long n = 1; n < ULLONG_MAX / 10; n = n * 10 + n % 7) {
+		xStrAssign(s, "");
+		xStrAppendUInt(s, n);
+		xStrAppendInt(s, -(long long)n);
+		snprintf(buf, sizeof(buf), "%llu%lld", n, -(long long)n);
+		assertEq(s, buf);
+	}
+
+	static const struct {
+		double d;
+		const char *str;
+	} doubles[] = {
+		{ 0.0, "0" }, { -0.0, "-0" }, { 1.0, "1" }, { -1.5, "-1.5" },
+		{ 0.1, "0.1" }, { 0.3, "0.3" }, { 1.0 / 3, "0.3333333333333333" },
+		{ 123456.789, "123456.789" }, { 1e21, "1e+21" }, { 1e20, "100000000000000000000" },
+		{ 1e-6, "0.000001" }, { 1e-7, "1e-7" }, { 1.5e-300, "1.5e-300" },
+		{ 5e-324, "5e-324" }, { 1.7976931348623157e308, "1.7976931348623157e+308" },
+		{ 2.2250738585072014e-308, "2.2250738585072014e-308" },
+		{ 9007199254740993.0, "9007199254740992" }, { 1e23, "1e+23" },
+		{ 1e126, "1e+126" }, { 5e-310, "5e-310" }, { 0x1p-1022, "2.2250738585072014e-308" },
+		{ 0x1p60, "1152921504606847000" }, { 1.0 / 0.0, "inf" },
+		{ -1.0 / 0.0, "-inf" }, { 0.0 / 0.0, "nan" },
+	};
+	for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+		xStrAssign(s, "");
+		xStrAppendDouble(s, doubles[i].d);
+		assertEq(s, doubles[i].str);
+	}
+
+	// random doubles read back exactly, and none of them from fewer digits
+	unsigned long long bits = 88172645463325252ull;
+	for (int i = 0; i < 100000; i++) {
+		bits ^= bits << 13;
+		bits ^= bits >> 7;
+		bits ^= bits << 17;
+		double d;
+		memcpy(&d, &bits, sizeof(d));
+		if (d != d || d - d != 0.0)
+			continue;
+		xStrAssign(s, "");
+		xStrAppendDouble(s, d);
+		assert(strtod(s->str, NULL) == d);
+		xStrSize e = xStrFirstIndexOfCh(s, 'e');
+		if (e >= 0)
+			xStrErase(s, e, -1);
+		xStrStrip(s, "-0.");
+		xStrReplace(s, ".", "", 0);
+		assert(s->len <= 17);
+		if (s->len > 1) {
+			snprintf(buf, sizeof(buf), "%.*e", (int)s->len - 2, d);
+			assert(strtod(buf, NULL) != d);
+		}
+	}
+	xStrAssign(s, "");
 }
 
 static void testLeftJustify(xStr *s)
@@ -529,6 +2129,13 @@ static void testRightJustify(xStr *s)
 	xStrRightJustify(s, 3, 'z');
 	assertEq(s, "zzz");
 	assertLen(s, strlen("zzz"));
+
+	// wide column
+	xStrAssign(s, "42");
+	xStrRightJustify(s, 1000, ' ');
+	assertLen(s, 1000);
+	assert(strcmp(s->str + 997, " 42") == 0);
+	assert(s->str[0] == ' ');
 }
 
 static void testCenter(xStr *s)
@@ -550,6 +2157,20 @@ static void testCenter(xStr *s)
 	xStrCenter(s, 8, ' ');
 	assertEq(s, "   abc  ");
 	assertLen(s, strlen("   abc  "));
+
+	// centering an empty string
+	xStrClear(s);
+	xStrCenter(s, 4, '-');
+	assertEq(s, "----");
+	assertLen(s, 4);
+
+	// padding past the inline buffer keeps the contents
+	xStrAssign(s, "abc");
+	xStrCenter(s, 101, '*');
+	assertLen(s, 101);
+	assert(strncmp(s->str + 48, "*abc*", 5) == 0);
+	assert(s->str[0] == '*' && s->str[100] == '*');
+	assertCap(s);
 }
 
 static void testStartsWith(xStr *s)
@@ -585,12 +2206,15 @@ int main()
 	testClear(&s);
 	testCompact(&s);
 	testReserve(&s);
+	testInline(&s);
+	testAllocator(&s);
 	testResize(&s);
 	testSwap(&s);
 	testAssign(&s);
 	testInsert(&s);
 	testPrepend(&s);
 	testAppend(&s);
+	testFormat(&s);
 	testErase(&s);
 	testOverwrite(&s);
 	testReplace(&s);
@@ -604,6 +2228,26 @@ int main()
 	testToLower(&s);
 	testFirstIndexOf(&s);
 	testLastIndexOf(&s);
+	testLimits(&s);
+	testBinary(&s);
+	testView(&s);
+	testSplitJoin(&s);
+	testRope(&s);
+	testGap(&s);
+	testHash(&s);
+	testMap(&s);
+	testIntern(&s);
+	testList(&s);
+	testGrowth(&s);
+#ifdef XSTR_STATS
+	testStats(&s);
+#endif
+	testCopy(&s);
+	testMapFile(&s);
+	testReader(&s);
+	testWriter(&s);
+	testConcat(&s);
+	testAppendNumber(&s);
 	testLeftJustify(&s);
 	testRightJustify(&s);
 	testCenter(&s);
@@ -1,575 +1,2853 @@
 #include "xstr.h"
 #include <ctype.h>
 #include <limits.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <wchar.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define XSTR_USABLE_SIZE(p) malloc_usable_size(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define XSTR_USABLE_SIZE(p) malloc_size(p)
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& !defined(XSTR_NO_SIMD)
+#define XSTR_X86 1
+#include <immintrin.h>
+#endif
 
 #define WS_CHARS " \t\n\r\v\f"
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
-void xStrInit(xStr *str, const char *init)
+#define ARENA_ALIGN (2 * sizeof(void *))
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define ARENA_DATA(b) ((char *)(b) + ARENA_ROUND(sizeof(xStrArenaBlock)))
+#define ARENA_DEFAULT_BLOCK 4096
+#define MANY_LENS 16
+
+struct xStrArenaBlock {
+	xStrArenaBlock *next;
+	size_t size, used;
+};
+
+static void *mallocAlloc(void *ctx, size_t size)
 {
-	xStrInitLen(str, init, -1);
+	(void)ctx;
+	return malloc(size);
 }
 
-void xStrInitLen(xStr *str, const char *init, int len)
+static void *mallocRealloc(void *ctx, void *ptr, size_t oldSize, size_t newSize)
 {
-	str->len = 0;
-	str->cap = 1;
-	str->str = malloc(1);
-	str->str[0] = '\0';
-	if (init)
-		xStrAppendLen(str, init, len);
+	(void)ctx;
+	(void)oldSize;
+	return realloc(ptr, newSize);
 }
 
-void xStrCleanup(xStr *str)
+static void mallocFree(void *ctx, void *ptr, size_t size)
 {
-	if (str)
-		free(str->str);
+	(void)ctx;
+	(void)size;
+	free(ptr);
 }
 
-xStr *xStrNew(const char *init)
+static const xStrAllocator mallocAllocator = {
+	mallocAlloc, mallocRealloc, mallocFree, NULL
+};
+
+static const xStrAllocator *defaultAllocator = &mallocAllocator;
+
+void xStrSetDefaultAllocator(const xStrAllocator *alloc)
 {
-	return xStrNewLen(init, -1);
+	defaultAllocator = alloc ? alloc : &mallocAllocator;
 }
 
-xStr *xStrNewLen(const char *init, int len)
+const xStrAllocator *xStrGetDefaultAllocator(void)
 {
-	xStr *str = malloc(sizeof(xStr));
-	if (str)
-		xStrInitLen(str, init, len);
-	return str;
+	return defaultAllocator;
 }
 
-void xStrDelete(xStr *str)
+static const xStrGrowth doublingGrowth = { XSTR_GROW_DOUBLE, 0, 0, 0 };
+static const xStrGrowth *growth = &doublingGrowth;
+
+void xStrSetDefaultGrowth(const xStrGrowth *policy)
 {
-	if (str) {
-		xStrCleanup(str);
-		free(str);
-	}
+	growth = policy ? policy : &doublingGrowth;
 }
 
-void xStrClear(xStr *str)
+const xStrGrowth *xStrGetDefaultGrowth(void)
 {
-	if (str->str)
-		str->str[0] = '\0';
-	str->len = 0;
+	return growth;
 }
 
-void xStrCompact(xStr *str)
+#ifdef XSTR_STATS
+#ifndef __GNUC__
+#error "XSTR_STATS needs GCC-compatible __thread and cleanup attributes"
+#endif
+
+static __thread xStrStatCounters statCounters[XSTR_SITE_COUNT];
+static __thread int statSite = -1;
+
+// The outermost xStr function on the stack claims the site; the cleanup
+// attribute restores it on every return path.
+static int statEnter(int site)
 {
-	int ncap = str->len + 1;
-	if (ncap != str->cap) {
-		void *tmp = realloc(str->str, ncap);
-		if (!tmp)
-			return;
-		str->str = tmp;
-		str->cap = ncap;
-	}
+	const int prev = statSite;
+	if (prev < 0)
+		statSite = site;
+	return prev;
 }
 
-void xStrReserve(xStr *str, int n)
+static void statLeave(const int *prev)
 {
-	int ncap = n + 1;
-	if (ncap > str->cap) {
-		void *tmp = realloc(str->str, ncap);
-		if (!tmp)
-			return;
-		str->str = tmp;
-		str->cap = ncap;
-	}
+	statSite = *prev;
 }
 
-void xStrResize(xStr *str, int len)
+#define STAT_SITE(site) \
+	const int statPrev __attribute__((cleanup(statLeave), unused)) = statEnter(site)
+#define STAT(field, n) \
+	(statCounters[statSite < 0 ? XSTR_SITE_OTHER : statSite].field += (n))
+#else
+#define STAT_SITE(site) ((void)0)
+#define STAT(field, n) ((void)0)
+#endif
+
+void xStrStatsSnapshot(xStrStats *stats)
 {
-	if (len < 0)
-		return;
-	if (len != str->len) {
-		if (len < str->len) {
-			str->str[len] = '\0';
-			str->len = len;
-		} else {
-			xStrReserve(str, len);
-			memset(str->str + str->len, 0, (len + 1) - str->len);
-			str->len = len;
-		}
+	memset(stats, 0, sizeof(*stats));
+#ifdef XSTR_STATS
+	xStrStatCounters *t = &stats->total;
+	for (int i = 0; i < XSTR_SITE_COUNT; i++) {
+		const xStrStatCounters *s = &statCounters[i];
+		stats->site[i] = *s;
+		t->allocs += s->allocs;
+		t->reallocs += s->reallocs;
+		t->frees += s->frees;
+		t->bytesAllocated += s->bytesAllocated;
+		t->bytesCopied += s->bytesCopied;
+		t->bytesSlack += s->bytesSlack;
 	}
+#endif
 }
 
-void xStrSwap(xStr *str, xStr *other)
+void xStrStatsReset(void)
 {
-	if (!str || !other)
-		return;
-	xStr tmp;
-	tmp = *str;
-	*str = *other;
-	*other = tmp;
+#ifdef XSTR_STATS
+	memset(statCounters, 0, sizeof(statCounters));
+#endif
 }
 
-void xStrAssign(xStr *str, const char *s)
+const char *xStrStatSiteName(xStrStatSite site)
 {
-	xStrAssignLen(str, s, -1);
+	static const char *const names[XSTR_SITE_COUNT] = {
+		"other", "init", "assign", "insert", "format", "erase",
+		"overwrite", "replace", "reserve", "compact", "pad", "join"
+	};
+	return (site >= 0 && site < XSTR_SITE_COUNT) ? names[site] : "unknown";
 }
 
-void xStrAssignLen(xStr *str, const char *s, int len)
+static void *strAlloc(const xStrAllocator *alloc, size_t size)
 {
-	xStrClear(str);
-	if (!s || len == 0)
-		return;
-	xStrAppendLen(str, s, len);
+	STAT(allocs, 1);
+	STAT(bytesAllocated, size);
+	return alloc->alloc(alloc->ctx, size);
 }
 
-void xStrAssignCh(xStr *str, char ch)
+static void *strRealloc(const xStrAllocator *alloc, void *ptr, size_t oldSize,
+	size_t newSize)
 {
-	char buf[2] = { ch, '\0' };
-	xStrAssignLen(str, buf, 1);
+	STAT(reallocs, 1);
+	STAT(bytesAllocated, newSize);
+	return alloc->realloc(alloc->ctx, ptr, oldSize, newSize);
 }
 
-void xStrAssignFmt(xStr *str, const char *fmt, ...)
+static void strFree(const xStrAllocator *alloc, void *ptr, size_t size)
 {
-	va_list ap;
-	va_start(ap, fmt);
-	xStrAssignFmtV(str, fmt, ap);
-	va_end(ap);
+	STAT(frees, 1);
+	alloc->free(alloc->ctx, ptr, size);
 }
 
-void xStrAssignFmtV(xStr *str, const char *fmt, va_list ap)
+static void *arenaRealloc(void *ctx, void *ptr, size_t oldSize, size_t newSize)
 {
-	va_list args;
-	xStrClear(str);
-	va_copy(args, ap);
-	xStrAppendFmtV(str, fmt, ap);
-	va_end(args);
+	xStrArena *arena = ctx;
+	if (ptr && ptr == arena->last) {
+		size_t off = arena->last - ARENA_DATA(arena->cur);
+		if (newSize <= arena->cur->size - off) {
+			arena->cur->used = off + newSize;
+			return ptr;
+		}
+	}
+	void *p = xStrArenaAlloc(arena, newSize);
+	if (p && ptr)
+		memcpy(p, ptr, MIN(oldSize, newSize));
+	return p;
 }
 
-static int xStrEnsureCap(xStr *str, int cap)
+static void *arenaAlloc(void *ctx, size_t size)
 {
-	if (cap > str->cap) {
-		int ncap = str->cap * 2;
-		ncap = MAX(ncap, cap);
-		void *tmp = realloc(str->str, ncap);
-		if (!tmp)
-			return 0;
-		str->str = tmp;
-		str->cap = ncap;
-	}
-	return 1;
+	return xStrArenaAlloc(ctx, size);
 }
 
-void xStrInsert(xStr *str, int pos, const char *s)
+static void arenaFree(void *ctx, void *ptr, size_t size)
 {
-	xStrInsertLen(str, pos, s, -1);
+	xStrArena *arena = ctx;
+	(void)size;
+	if (ptr && ptr == arena->last) {
+		arena->cur->used = arena->last - ARENA_DATA(arena->cur);
+		arena->last = NULL;
+	}
 }
 
-void xStrInsertLen(xStr *str, int pos, const char *s, int len)
+void xStrArenaInit(xStrArena *arena, size_t blockSize)
 {
-	if (!s || pos < 0 || pos > str->len)
-		return;
-	if (len < 0)
-		len = strlen(s);
-	int nlen = str->len + len;
-	if (!xStrEnsureCap(str, nlen + 1))
-		return;
-	if (pos < str->len)
-		memmove(str->str + pos + len, str->str + pos, (str->len - pos) + 1);
-	memcpy(str->str + pos, s, len);
-	str->len += len;
-	str->str[str->len] = '\0';
+	xStrArenaInitAlloc(arena, blockSize, NULL);
 }
 
-void xStrInsertCh(xStr *str, int pos, char ch)
+void xStrArenaInitAlloc(xStrArena *arena, size_t blockSize, const xStrAllocator *alloc)
 {
-	char buf[2] = { ch, 0 };
-	xStrInsertLen(str, pos, buf, 1);
+	arena->allocator.alloc = arenaAlloc;
+	arena->allocator.realloc = arenaRealloc;
+	arena->allocator.free = arenaFree;
+	arena->allocator.ctx = arena;
+	arena->backing = alloc ? alloc : defaultAllocator;
+	arena->first = arena->cur = NULL;
+	arena->blockSize = blockSize ? blockSize : ARENA_DEFAULT_BLOCK;
+	arena->last = NULL;
 }
 
-void xStrInsertFmt(xStr *str, int pos, const char *fmt, ...)
+void xStrArenaCleanup(xStrArena *arena)
 {
-	va_list ap;
-	va_start(ap, fmt);
-	xStrInsertFmtV(str, pos, fmt, ap);
-	va_end(ap);
+	if (!arena)
+		return;
+	xStrArenaBlock *b = arena->first;
+	while (b) {
+		xStrArenaBlock *next = b->next;
+		arena->backing->free(arena->backing->ctx, b, ARENA_ROUND(sizeof(xStrArenaBlock)) + b->size);
+		b = next;
+	}
+	arena->first = arena->cur = NULL;
+	arena->last = NULL;
 }
 
-static char *strFormat(int *len, const char *fmt, va_list ap)
+void xStrArenaReset(xStrArena *arena)
 {
-	int size = 0;
-	char *p = NULL;
-	va_list args;
-
-	va_copy(args, ap);
-	// cppcheck false positive for p being NULL, see C11 draft 7.21.6.5/12
-	size = vsnprintf(p /* cppcheck-suppress nullPointer */, size, fmt, args);
-	va_end(args);
-
-	if (size < 0)
-		return NULL;
-
-	size++;
-	p = malloc(size);
-	if (p == NULL)
-		return NULL;
-
-	va_copy(args, ap);
-	size = vsnprintf(p, size, fmt, args);
-	va_end(args);
+	arena->cur = arena->first;
+	if (arena->cur)
+		arena->cur->used = 0;
+	arena->last = NULL;
+}
 
-	if (size < 0) {
-		free(p);
+void *xStrArenaAlloc(xStrArena *arena, size_t size)
+{
+	xStrArenaBlock *b = arena->cur;
+	size_t off = 0;
+	if (b) {
+		off = ARENA_ROUND(b->used);
+		if (off <= b->size && size <= b->size - off)
+			goto found;
+		// blocks kept from before the last reset are reused in order
+		if (b->next && size <= b->next->size) {
+			b = b->next;
+			b->used = off = 0;
+			goto found;
+		}
+	}
+	size_t blockSize = MAX(size, arena->blockSize);
+	xStrArenaBlock *nb = arena->backing->alloc(arena->backing->ctx,
+		ARENA_ROUND(sizeof(xStrArenaBlock)) + blockSize);
+	if (!nb)
 		return NULL;
+	nb->size = blockSize;
+	nb->used = off = 0;
+	if (b) {
+		nb->next = b->next;
+		b->next = nb;
+	} else {
+		nb->next = arena->first;
+		arena->first = nb;
 	}
+	b = nb;
+found:
+	arena->cur = b;
+	b->used = off + size;
+	arena->last = ARENA_DATA(b) + off;
+	return arena->last;
+}
 
-	if (len)
-		*len = size;
-
-	return p;
+// The context is set here rather than trusted from init, so an arena that
+// was moved before anyone asked for its allocator still works.
+const xStrAllocator *xStrArenaAllocator(xStrArena *arena)
+{
+	arena->allocator.ctx = arena;
+	return &arena->allocator;
 }
 
-void xStrInsertFmtV(xStr *str, int pos, const char *fmt, va_list ap)
+static int strIsInline(const xStr *str)
 {
-	int len = 0;
-	char *tmp = strFormat(&len, fmt, ap);
-	if (tmp != NULL) {
-		xStrInsertLen(str, pos, tmp, len);
-		free(tmp);
-	}
+	return (str->str == str->buf);
 }
 
-void xStrPrepend(xStr *str, const char *s)
+// Extends cap to the whole block the malloc allocator handed out.
+static xStrSize strUsableCap(const xStr *str, xStrSize cap)
 {
-	xStrPrependLen(str, s, -1);
+#ifdef XSTR_USABLE_SIZE
+	if (growth->roundUp && str->alloc == &mallocAllocator) {
+		const size_t usable = XSTR_USABLE_SIZE(str->str);
+		if (usable > (size_t)cap)
+			return (usable > (size_t)XSTR_SIZE_MAX) ? XSTR_SIZE_MAX : (xStrSize)usable;
+	}
+#else
+	(void)str;
+#endif
+	return cap;
 }
 
-void xStrPrependLen(xStr *str, const char *s, int len)
+// A buffer shared by several strings, either one of ours handed out by
+// xStrCopy() or an external one that release gives back. A string holding
+// one isn't using its inline buffer, so the pointer is kept there, and cap
+// is 0 since there is no room it may write to.
+struct xStrShared {
+	long refs;
+	char *data;
+	xStrSize len, cap;
+	const xStrAllocator *alloc;
+	xStrReleaseFunc release;
+	void *ctx;
+};
+
+#ifdef __GNUC__
+#define REF_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_RELAXED)
+#define REF_DEC(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#define REF_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#else
+#define REF_INC(p) (++*(p))
+#define REF_DEC(p) (--*(p))
+#define REF_LOAD(p) (*(p))
+#endif
+
+static xStrShared *strShared(const xStr *str)
 {
-	xStrInsertLen(str, 0, s, len);
+	xStrShared *sh = NULL;
+	if (str->cap == 0)
+		memcpy(&sh, str->buf, sizeof(sh));
+	return sh;
 }
 
-void xStrPrependCh(xStr *str, char ch)
+static void strSetShared(xStr *str, xStrShared *sh)
 {
-	xStrInsertCh(str, 0, ch);
+	memcpy(str->buf, &sh, sizeof(sh));
+	str->cap = 0;
 }
 
-void xStrPrependFmt(xStr *str, const char *fmt, ...)
+// The capacity of the buffer str holds, shared or not.
+static xStrSize strCap(const xStr *str)
 {
-	va_list ap;
-	va_start(ap, fmt);
-	xStrPrependFmtV(str, fmt, ap);
-	va_end(ap);
+	const xStrShared *sh = strShared(str);
+	return sh ? sh->cap : str->cap;
 }
 
-void xStrPrependFmtV(xStr *str, const char *fmt, va_list ap)
+static void strRelease(xStrShared *sh)
 {
-	va_list args;
-	va_copy(args, ap);
-	xStrInsertFmtV(str, 0, fmt, args);
-	va_end(args);
+	if (REF_DEC(&sh->refs) != 0)
+		return;
+	if (sh->release)
+		sh->release(sh->ctx, sh->data, sh->len);
+	else
+		strFree(sh->alloc, sh->data, sh->cap);
+	strFree(sh->alloc, sh, sizeof(*sh));
 }
 
-void xStrAppend(xStr *str, const char *s)
+// Whether str holds the last reference to a buffer of ours, which it can
+// simply take back instead of copying.
+static int strSoleOwner(const xStr *str)
 {
-	xStrAppendLen(str, s, -1);
+	const xStrShared *sh = strShared(str);
+	return !sh->release && sh->alloc == str->alloc && REF_LOAD(&sh->refs) == 1;
 }
 
-void xStrAppendLen(xStr *str, const char *s, int len)
+static void strReclaim(xStr *str)
 {
-	xStrInsertLen(str, str->len, s, len);
+	xStrShared *sh = strShared(str);
+	str->cap = sh->cap;
+	strFree(sh->alloc, sh, sizeof(*sh));
 }
 
-void xStrAppendCh(xStr *str, char ch)
+// Gives str a private copy of its contents in a buffer of at least cap bytes.
+static int strCopyShared(xStr *str, xStrSize cap)
 {
-	xStrInsertCh(str, str->len, ch);
+	xStrShared *sh = strShared(str);
+	char *tmp = str->buf;
+	cap = MAX(cap, str->len + 1);
+	if (cap > XSTR_INLINE_CAP) {
+		tmp = strAlloc(str->alloc, cap);
+		if (!tmp)
+			return 0;
+	}
+	memcpy(tmp, str->str, str->len + 1);
+	STAT(bytesCopied, str->len + 1);
+	str->str = tmp;
+	str->cap = (tmp == str->buf) ? XSTR_INLINE_CAP : strUsableCap(str, cap);
+	strRelease(sh);
+	return 1;
 }
 
-void xStrAppendFmt(xStr *str, const char *fmt, ...)
+// Called before writing to the buffer in place, with cap the size the
+// caller needs if it has to be copied.
+static int strUnshare(xStr *str, xStrSize cap)
 {
-	va_list ap;
-	va_start(ap, fmt);
-	xStrAppendFmtV(str, fmt, ap);
-	va_end(ap);
+	if (!strShared(str))
+		return 1;
+	if (!strSoleOwner(str))
+		return strCopyShared(str, cap);
+	strReclaim(str);
+	return 1;
 }
 
-void xStrAppendFmtV(xStr *str, const char *fmt, va_list ap)
+// Drops whatever buffer str holds, leaving it empty and inline.
+static void strDropBuffer(xStr *str)
 {
-	va_list args;
-	va_copy(args, ap);
-	xStrInsertFmtV(str, str->len, fmt, args);
-	va_end(args);
+	xStrShared *sh = strShared(str);
+	if (sh)
+		strRelease(sh);
+	else if (!strIsInline(str))
+		strFree(str->alloc, str->str, str->cap);
+	str->str = str->buf;
+	str->cap = XSTR_INLINE_CAP;
+	str->len = 0;
+	str->buf[0] = '\0';
 }
 
-void xStrErase(xStr *str, int pos, int len)
+static int strSetCap(xStr *str, xStrSize ncap)
 {
-	if (pos < 0 || pos >= str->len || len == 0 || len < -1)
-		return;
-	if (len == -1)
-		len = str->len - pos;
-	int end;
-	if ((pos + len) > str->len)
-		end = str->len;
-	else
-		end = pos + len;
-	if (end == str->len) {
-		str->str[pos] = '\0';
-		str->len = pos;
+	if (strShared(str)) {
+		if (!strSoleOwner(str))
+			return strCopyShared(str, ncap);
+		strReclaim(str);
+	}
+	if (ncap <= XSTR_INLINE_CAP) {
+		if (!strIsInline(str)) {
+			memcpy(str->buf, str->str, str->len + 1);
+			STAT(bytesCopied, str->len + 1);
+			strFree(str->alloc, str->str, str->cap);
+			str->str = str->buf;
+			str->cap = XSTR_INLINE_CAP;
+		}
+		return 1;
+	}
+	if (strIsInline(str)) {
+		char *tmp = strAlloc(str->alloc, ncap);
+		if (!tmp)
+			return 0;
+		memcpy(tmp, str->buf, str->len + 1);
+		STAT(bytesCopied, str->len + 1);
+		str->str = tmp;
 	} else {
-		memmove(str->str + pos, str->str + end, str->len - (end - pos));
-		str->len -= len;
-		str->str[str->len] = '\0';
+		char *tmp = strRealloc(str->alloc, str->str, str->cap, ncap);
+		if (!tmp)
+			return 0;
+		str->str = tmp;
 	}
+	str->cap = strUsableCap(str, ncap);
+	return 1;
 }
 
-void xStrOverwrite(xStr *str, int pos, int len, const char *s)
+// Gives memory back once the string needs far less than it holds.
+static void strShrink(xStr *str)
 {
-	xStrOverwriteLen(str, pos, len, s, -1);
+	const int factor = growth->shrinkFactor;
+	const xStrSize need = str->len + 1;
+	if (factor >= 2 && !strIsInline(str) && !strShared(str) && str->cap / factor > need)
+		strSetCap(str, need * factor / 2);
 }
 
-void xStrOverwriteLen(xStr *str, int pos, int len, const char *s, int slen)
+void xStrInit(xStr *str, const char *init)
 {
-	if (slen < 0)
-		slen = strlen(s);
-	xStrErase(str, pos, len);
-	if (s && slen > 0)
-		xStrInsertLen(str, pos, s, slen);
+	xStrInitLen(str, init, -1);
 }
 
-void xStrOverwriteCh(xStr *str, int pos, int len, char ch)
+void xStrInitLen(xStr *str, const char *init, xStrSize len)
 {
-	char buf[2] = { ch, 0 };
-	xStrOverwriteLen(str, pos, len, buf, -1);
+	xStrInitLenAlloc(str, init, len, NULL);
 }
 
-void xStrOverwriteFmt(xStr *str, int pos, int len, const char *fmt, ...)
+void xStrInitAlloc(xStr *str, const char *init, const xStrAllocator *alloc)
 {
-	va_list ap;
-	va_start(ap, fmt);
-	xStrOverwriteFmtV(str, pos, len, fmt, ap);
-	va_end(ap);
+	xStrInitLenAlloc(str, init, -1, alloc);
 }
 
-void xStrOverwriteFmtV(xStr *str, int pos, int len, const char *fmt,
-	va_list ap)
+void xStrInitLenAlloc(xStr *str, const char *init, xStrSize len,
+	const xStrAllocator *alloc)
 {
-	va_list args;
-	va_copy(args, ap);
-	int slen = 0;
-	char *tmp = strFormat(&slen, fmt, args);
-	va_end(args);
-	xStrOverwriteLen(str, pos, len, tmp, slen);
-	free(tmp);
+	STAT_SITE(XSTR_SITE_INIT);
+	str->alloc = alloc ? alloc : defaultAllocator;
+	str->len = 0;
+	str->cap = XSTR_INLINE_CAP;
+	str->str = str->buf;
+	str->buf[0] = '\0';
+	if (init)
+		xStrAppendLen(str, init, len);
 }
 
-static int strFirstIndexOf(const char *s, const char *find)
+void xStrCleanup(xStr *str)
 {
-	const char *found = strstr(s, find);
-	if (!found)
-		return -1;
-	return (found - s);
+	STAT_SITE(XSTR_SITE_INIT);
+	if (str && strShared(str))
+		strRelease(strShared(str));
+	else if (str && !strIsInline(str))
+		strFree(str->alloc, str->str, str->cap);
 }
 
-void xStrReplace(xStr *str, const char *needle, const char *repl,
-	int maxReplace)
+void xStrSetAllocator(xStr *str, const xStrAllocator *alloc)
 {
-	if (!needle || !repl || maxReplace < 0 || str->len == 0)
+	STAT_SITE(XSTR_SITE_INIT);
+	if (!alloc)
+		alloc = defaultAllocator;
+	if (alloc == str->alloc)
 		return;
-
-	int pos = 0;
-	int numReplaced = 0;
-	const int needleLen = strlen(needle);
-	const int replLen = strlen(repl);
-
-	while (pos < str->len && (maxReplace < 1 || numReplaced < maxReplace)) {
-		int idx = strFirstIndexOf(str->str + pos, needle);
-		if (idx >= 0) {
-			pos += idx;
-			xStrOverwriteLen(str, pos, needleLen, repl, replLen);
-			numReplaced++;
-		} else {
-			break;
-		}
+	// a shared buffer goes back to the allocator it came from
+	if (!strIsInline(str) && !strShared(str)) {
+		char *tmp = strAlloc(alloc, str->cap);
+		if (!tmp)
+			return;
+		memcpy(tmp, str->str, str->len + 1);
+		STAT(bytesCopied, str->len + 1);
+		strFree(str->alloc, str->str, str->cap);
+		str->str = tmp;
 	}
+	str->alloc = alloc;
 }
 
-void xStrStripFront(xStr *str, const char *chrs)
+void xStrInitCopy(xStr *str, xStr *src)
 {
-	if (!chrs)
-		chrs = WS_CHARS;
-	const char *start;
-	for (start = str->str; *start && (strchr(chrs, *start) != NULL); start++)
-		;
-	int len = strlen(start);
-	memmove(str->str, start, len + 1);
-	str->len = len;
+	xStrInitAlloc(str, NULL, src->alloc);
+	xStrCopy(str, src);
 }
 
-void xStrStripBack(xStr *str, const char *chrs)
+void xStrCopy(xStr *str, xStr *src)
 {
-	if (!chrs)
-		chrs = WS_CHARS;
-	int len = str->len;
-	while (len--) {
-		if (strchr(chrs, str->str[len]) != NULL)
-			str->str[len] = '\0';
-		else
-			break;
+	STAT_SITE(XSTR_SITE_ASSIGN);
+	xStrShared *sh = strShared(src);
+	if (str == src || (sh && strShared(str) == sh))
+		return;
+	if (strIsInline(src)) {
+		xStrAssignLen(str, src->str, src->len);
+		return;
 	}
-	str->len = strlen(str->str);
+	if (!sh) {
+		sh = strAlloc(src->alloc, sizeof(*sh));
+		if (!sh) {
+			xStrAssignLen(str, src->str, src->len);
+			return;
+		}
+		sh->refs = 1;
+		sh->data = src->str;
+		sh->len = src->len;
+		sh->cap = src->cap;
+		sh->alloc = src->alloc;
+		sh->release = NULL;
+		sh->ctx = NULL;
+		strSetShared(src, sh);
+	}
+	strDropBuffer(str);
+	REF_INC(&sh->refs);
+	strSetShared(str, sh);
+	str->str = src->str;
+	str->len = src->len;
 }
 
-void xStrStrip(xStr *str, const char *chrs)
+int xStrIsShared(const xStr *str)
 {
-	xStrStripFront(str, chrs);
-	xStrStripBack(str, chrs);
+	const xStrShared *sh = strShared(str);
+	return sh && REF_LOAD(&sh->refs) > 1;
 }
 
-int xStrCompare(const xStr *str1, const xStr *str2)
+static void strKeepExternal(void *ctx, const char *data, xStrSize len)
 {
-	if (!str1 || !str2)
-		return (str1 - str2);
-	else if (!str1->str || !str2->str)
-		return (str1->str - str2->str);
-	else
-		return strcmp(str1->str, str2->str);
+	(void)ctx;
+	(void)data;
+	(void)len;
 }
 
-static int strCaseCompare(char *s1, char *s2)
+void xStrInitExternal(xStr *str, const char *data, xStrSize len,
+	xStrReleaseFunc release, void *ctx)
 {
-	if (s1 == s2)
-		return 0;
-	const unsigned char *p1 = (unsigned char *)s1;
-	const unsigned char *p2 = (unsigned char *)s2;
-	unsigned char c1, c2;
-	do {
-		c1 = tolower(*p1), c2 = tolower(*p2);
-		if (!c1)
-			break;
-		p1++, p2++;
-	} while (c1 == c2);
-#if UCHAR_MAX <= INT_MAX
-	return c1 - c2;
-#else
-	return (c1 > c2 ? 1 : (c1 < c2 ? -1 : 0));
-#endif
+	STAT_SITE(XSTR_SITE_INIT);
+	xStrInit(str, NULL);
+	if (!data || len < 0 || len >= XSTR_SIZE_MAX) {
+		if (data && release)
+			release(ctx, data, len);
+		return;
+	}
+	xStrShared *sh = strAlloc(str->alloc, sizeof(*sh));
+	if (!sh) {
+		// fall back to a copy so the caller's buffer is still released
+		xStrAppendLen(str, data, len);
+		if (release)
+			release(ctx, data, len);
+		return;
+	}
+	sh->refs = 1;
+	sh->data = (char *)data;
+	sh->len = len;
+	sh->cap = len + 1;
+	sh->alloc = str->alloc;
+	sh->release = release ? release : strKeepExternal;
+	sh->ctx = ctx;
+	strSetShared(str, sh);
+	str->str = sh->data;
+	str->len = len;
 }
 
-int xStrCaseCompare(const xStr *str1, const xStr *str2)
+xStr *xStrNew(const char *init)
+{
+	return xStrNewLen(init, -1);
+}
+
+xStr *xStrNewLen(const char *init, xStrSize len)
+{
+	STAT_SITE(XSTR_SITE_INIT);
+	STAT(allocs, 1);
+	STAT(bytesAllocated, sizeof(xStr));
+	xStr *str = malloc(sizeof(xStr));
+	if (str)
+		xStrInitLen(str, init, len);
+	return str;
+}
+
+void xStrDelete(xStr *str)
+{
+	STAT_SITE(XSTR_SITE_INIT);
+	if (str) {
+		xStrCleanup(str);
+		STAT(frees, 1);
+		free(str);
+	}
+}
+
+void xStrClear(xStr *str)
+{
+	if (strShared(str))
+		strDropBuffer(str);
+	else if (str->str)
+		str->str[0] = '\0';
+	str->len = 0;
+}
+
+void xStrCompact(xStr *str)
+{
+	STAT_SITE(XSTR_SITE_COMPACT);
+	xStrSize ncap = str->len + 1;
+	// a buffer others still use isn't ours to trim
+	if (strShared(str) && !strSoleOwner(str))
+		return;
+	if (ncap != strCap(str))
+		strSetCap(str, ncap);
+}
+
+void xStrReserve(xStr *str, xStrSize n)
+{
+	STAT_SITE(XSTR_SITE_RESERVE);
+	if (n < 0 || n >= XSTR_SIZE_MAX)
+		return;
+	xStrSize ncap = n + 1;
+	if (ncap > strCap(str))
+		strSetCap(str, ncap);
+}
+
+void xStrResize(xStr *str, xStrSize len)
+{
+	STAT_SITE(XSTR_SITE_RESERVE);
+	if (len < 0)
+		return;
+	if (len != str->len && strUnshare(str, str->len + 1)) {
+		if (len < str->len) {
+			str->str[len] = '\0';
+			str->len = len;
+			strShrink(str);
+		} else {
+			xStrReserve(str, len);
+			if (str->cap <= len)
+				return;
+			memset(str->str + str->len, 0, (len + 1) - str->len);
+			str->len = len;
+		}
+	}
+}
+
+void xStrSwap(xStr *str, xStr *other)
+{
+	if (!str || !other)
+		return;
+	const int strInline = strIsInline(str);
+	const int otherInline = strIsInline(other);
+	xStr tmp;
+	tmp = *str;
+	*str = *other;
+	*other = tmp;
+	if (otherInline)
+		str->str = str->buf;
+	if (strInline)
+		other->str = other->buf;
+}
+
+void xStrAssign(xStr *str, const char *s)
+{
+	xStrAssignLen(str, s, -1);
+}
+
+void xStrAssignLen(xStr *str, const char *s, xStrSize len)
+{
+	STAT_SITE(XSTR_SITE_ASSIGN);
+	xStrClear(str);
+	if (s && len != 0)
+		xStrAppendLen(str, s, len);
+	strShrink(str);
+}
+
+void xStrAssignCh(xStr *str, char ch)
+{
+	char buf[2] = { ch, '\0' };
+	xStrAssignLen(str, buf, 1);
+}
+
+void xStrAssignFmt(xStr *str, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	xStrAssignFmtV(str, fmt, ap);
+	va_end(ap);
+}
+
+void xStrAssignFmtV(xStr *str, const char *fmt, va_list ap)
+{
+	STAT_SITE(XSTR_SITE_ASSIGN);
+	xStrClear(str);
+	xStrAppendFmtV(str, fmt, ap);
+	strShrink(str);
+}
+
+static int xStrEnsureCap(xStr *str, xStrSize cap)
+{
+	const xStrSize cur = strCap(str);
+	if (cap <= cur)
+		return strUnshare(str, cap);
+	xStrSize ncap;
+	switch (growth->kind) {
+	case XSTR_GROW_HALF:
+		ncap = (cur > XSTR_SIZE_MAX / 3 * 2) ? XSTR_SIZE_MAX : cur + cur / 2;
+		break;
+	case XSTR_GROW_FIXED:
+		ncap = (growth->increment <= 0) ? cap
+			: (cur > XSTR_SIZE_MAX - growth->increment) ? XSTR_SIZE_MAX
+			: cur + growth->increment;
+		break;
+	case XSTR_GROW_EXACT:
+		ncap = cap;
+		break;
+	default:
+		ncap = (cur > XSTR_SIZE_MAX / 2) ? XSTR_SIZE_MAX : cur * 2;
+		break;
+	}
+	ncap = MAX(ncap, cap);
+	STAT(bytesSlack, ncap - cap);
+	return strSetCap(str, ncap);
+}
+
+void xStrInsert(xStr *str, xStrSize pos, const char *s)
+{
+	xStrInsertLen(str, pos, s, -1);
+}
+
+void xStrInsertLen(xStr *str, xStrSize pos, const char *s, xStrSize len)
+{
+	STAT_SITE(XSTR_SITE_INSERT);
+	if (!s || pos < 0 || pos > str->len)
+		return;
+	if (len < 0) {
+		size_t slen = strlen(s);
+		if (slen > (size_t)XSTR_SIZE_MAX)
+			return;
+		len = slen;
+	}
+	if (len > XSTR_SIZE_MAX - 1 - str->len)
+		return;
+	xStrSize nlen = str->len + len;
+	if (!xStrEnsureCap(str, nlen + 1))
+		return;
+	if (pos < str->len)
+		memmove(str->str + pos + len, str->str + pos, (str->len - pos) + 1);
+	memcpy(str->str + pos, s, len);
+	STAT(bytesCopied, (str->len - pos) + len);
+	str->len += len;
+	str->str[str->len] = '\0';
+}
+
+void xStrInsertCh(xStr *str, xStrSize pos, char ch)
+{
+	char buf[2] = { ch, 0 };
+	xStrInsertLen(str, pos, buf, 1);
+}
+
+void xStrInsertFmt(xStr *str, xStrSize pos, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	xStrInsertFmtV(str, pos, fmt, ap);
+	va_end(ap);
+}
+
+// Formats into a stack buffer, or one of the exact size when that's too
+// small, and copies the result after the string once it is complete.
+static int strFormatScratch(xStr *str, const char *fmt, va_list ap)
+{
+	char stack[256];
+	char *tmp = stack;
+	va_list args;
+
+	va_copy(args, ap);
+	int size = vsnprintf(stack, sizeof(stack), fmt, args);
+	va_end(args);
+	if (size < 0 || size > XSTR_SIZE_MAX - 1 - str->len)
+		return -1;
+	if (size >= (int)sizeof(stack)) {
+		tmp = strAlloc(str->alloc, (size_t)size + 1);
+		if (!tmp)
+			return -1;
+		va_copy(args, ap);
+		vsnprintf(tmp, (size_t)size + 1, fmt, args);
+		va_end(args);
+	}
+
+	const int ok = xStrEnsureCap(str, str->len + size + 1);
+	if (ok) {
+		memcpy(str->str + str->len, tmp, (size_t)size + 1);
+		STAT(bytesCopied, size);
+	}
+	if (tmp != stack)
+		strFree(str->alloc, tmp, (size_t)size + 1);
+	return ok ? size : -1;
+}
+
+// Whether a %s argument points into the buffer of str. Walks the
+// conversions to pull each argument off a copy of ap with its real type;
+// formats it can't follow, like positional arguments, count as aliasing.
+static int strFormatAliases(const xStr *str, const char *fmt, va_list ap)
+{
+	const char *lo = str->str, *hi = str->str + strCap(str);
+	int aliases = 0;
+	va_list args;
+
+	va_copy(args, ap);
+	for (const char *f = strchr(fmt, '%'); f && !aliases; f = strchr(f, '%')) {
+		f++;
+		if (*f == '%') {
+			f++;
+			continue;
+		}
+		f += strspn(f, "-+ #0");
+		if (*f == '*') {
+			(void)va_arg(args, int);
+			f++;
+		}
+		f += strspn(f, "0123456789");
+		if (*f == '.') {
+			f++;
+			if (*f == '*') {
+				(void)va_arg(args, int);
+				f++;
+			}
+			f += strspn(f, "0123456789");
+		}
+		// the length modifier, with ll folded into L
+		int size = 0;
+		if (*f == 'h' || *f == 'l') {
+			size = (f[0] == 'l' && f[1] == 'l') ? 'L' : *f;
+			f += (f[1] == f[0]) ? 2 : 1;
+		} else if (*f && strchr("jztL", *f)) {
+			size = *f++;
+		}
+		switch (*f++) {
+		case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+			if (size == 'l')
+				(void)va_arg(args, long);
+			else if (size == 'L')
+				(void)va_arg(args, long long);
+			else if (size == 'j')
+				(void)va_arg(args, intmax_t);
+			else if (size == 'z')
+				(void)va_arg(args, size_t);
+			else if (size == 't')
+				(void)va_arg(args, ptrdiff_t);
+			else
+				(void)va_arg(args, int);
+			break;
+		case 'c':
+			if (size == 'l')
+				(void)va_arg(args, wint_t);
+			else
+				(void)va_arg(args, int);
+			break;
+		case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+			if (size == 'L')
+				(void)va_arg(args, long double);
+			else
+				(void)va_arg(args, double);
+			break;
+		case 's': {
+			const char *p = (size == 'l') ? (const char *)va_arg(args, const wchar_t *)
+				: va_arg(args, const char *);
+			aliases = p >= lo && p < hi;
+			break;
+		}
+		case 'p': case 'n':
+			(void)va_arg(args, void *);
+			break;
+		default:
+			aliases = 1;
+			break;
+		}
+	}
+	va_end(args);
+	return aliases;
+}
+
+// Formats into the spare capacity after the string, growing and retrying
+// only when it doesn't fit. The length is left unchanged; returns the number
+// of bytes written at str->str + str->len, or -1 on failure.
+static int strFormatTail(xStr *str, const char *fmt, va_list ap)
+{
+	va_list args;
+	// a %s argument pointing into str would be overwritten by formatting in
+	// place or freed by growing, so those go through scratch space
+	if (strchr(fmt, 's') && strFormatAliases(str, fmt, ap))
+		return strFormatScratch(str, fmt, ap);
+	if (!strUnshare(str, str->len + 1))
+		return -1;
+	const xStrSize avail = str->cap - str->len;
+
+	va_copy(args, ap);
+	int size = vsnprintf(str->str + str->len, avail, fmt, args);
+	va_end(args);
+
+	if (size >= avail) {
+		if (size > XSTR_SIZE_MAX - 1 - str->len
+			|| !xStrEnsureCap(str, str->len + size + 1)) {
+			str->str[str->len] = '\0';
+			return -1;
+		}
+		va_copy(args, ap);
+		size = vsnprintf(str->str + str->len, size + 1, fmt, args);
+		va_end(args);
+	}
+
+	if (size < 0) {
+		str->str[str->len] = '\0';
+		return -1;
+	}
+
+	return size;
+}
+
+// Moves the last tailLen bytes of p to the front, shifting the rest right.
+static void strRotate(char *p, xStrSize headLen, xStrSize tailLen)
+{
+	char tmp[256];
+	STAT(bytesCopied, headLen + tailLen);
+	if (tailLen <= (xStrSize)sizeof(tmp)) {
+		memcpy(tmp, p + headLen, tailLen);
+		memmove(p + tailLen, p, headLen);
+		memcpy(p, tmp, tailLen);
+	} else {
+		char *a, *b, c;
+		for (a = p, b = p + headLen - 1; a < b; a++, b--)
+			c = *a, *a = *b, *b = c;
+		for (a = p + headLen, b = p + headLen + tailLen - 1; a < b; a++, b--)
+			c = *a, *a = *b, *b = c;
+		for (a = p, b = p + headLen + tailLen - 1; a < b; a++, b--)
+			c = *a, *a = *b, *b = c;
+	}
+}
+
+void xStrInsertFmtV(xStr *str, xStrSize pos, const char *fmt, va_list ap)
+{
+	STAT_SITE(XSTR_SITE_FORMAT);
+	if (pos < 0 || pos > str->len)
+		return;
+	xStrSize len = strFormatTail(str, fmt, ap);
+	if (len < 0)
+		return;
+	if (pos < str->len)
+		strRotate(str->str + pos, str->len - pos, len);
+	str->len += len;
+	str->str[str->len] = '\0';
+}
+
+void xStrPrepend(xStr *str, const char *s)
+{
+	xStrPrependLen(str, s, -1);
+}
+
+void xStrPrependLen(xStr *str, const char *s, xStrSize len)
+{
+	xStrInsertLen(str, 0, s, len);
+}
+
+void xStrPrependCh(xStr *str, char ch)
+{
+	xStrInsertCh(str, 0, ch);
+}
+
+void xStrPrependFmt(xStr *str, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	xStrPrependFmtV(str, fmt, ap);
+	va_end(ap);
+}
+
+void xStrPrependFmtV(xStr *str, const char *fmt, va_list ap)
+{
+	va_list args;
+	va_copy(args, ap);
+	xStrInsertFmtV(str, 0, fmt, args);
+	va_end(args);
+}
+
+void xStrAppend(xStr *str, const char *s)
+{
+	xStrAppendLen(str, s, -1);
+}
+
+void xStrAppendLen(xStr *str, const char *s, xStrSize len)
+{
+	xStrInsertLen(str, str->len, s, len);
+}
+
+void xStrAppendCh(xStr *str, char ch)
+{
+	xStrInsertCh(str, str->len, ch);
+}
+
+void xStrAppendFmt(xStr *str, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	xStrAppendFmtV(str, fmt, ap);
+	va_end(ap);
+}
+
+void xStrAppendFmtV(xStr *str, const char *fmt, va_list ap)
+{
+	STAT_SITE(XSTR_SITE_FORMAT);
+	xStrSize len = strFormatTail(str, fmt, ap);
+	if (len > 0)
+		str->len += len;
+}
+
+void xStrAppendMany(xStr *str, ...)
+{
+	va_list ap;
+	va_start(ap, str);
+	xStrAppendManyV(str, ap);
+	va_end(ap);
+}
+
+void xStrConcat(xStr *str, ...)
+{
+	va_list ap;
+	va_start(ap, str);
+	xStrClear(str);
+	xStrAppendManyV(str, ap);
+	va_end(ap);
+}
+
+// Parts may come from str itself, so ones inside the old buffer are read
+// from wherever growing it moved them to.
+static const char *strRebase(const xStr *str, const char *s, const char *old,
+	xStrSize oldCap)
+{
+	return (s >= old && s < old + oldCap) ? str->str + (s - old) : s;
+}
+
+void xStrAppendManyV(xStr *str, va_list ap)
+{
+	STAT_SITE(XSTR_SITE_INSERT);
+	size_t lens[MANY_LENS];
+	size_t total = 0, count = 0;
+	const char *s;
+	va_list args;
+
+	va_copy(args, ap);
+	while ((s = va_arg(args, const char *)) != NULL) {
+		const size_t n = strlen(s);
+		if (n > (size_t)XSTR_SIZE_MAX - total) {
+			va_end(args);
+			return;
+		}
+		if (count < MANY_LENS)
+			lens[count] = n;
+		count++;
+		total += n;
+	}
+	va_end(args);
+
+	if (total > (size_t)(XSTR_SIZE_MAX - 1 - str->len))
+		return;
+	const char *old = str->str;
+	const xStrSize oldCap = strCap(str), oldLen = str->len;
+	if (!xStrEnsureCap(str, str->len + total + 1))
+		return;
+	// copying overwrites the terminator, so parts taken from str can't be
+	// measured again; past the first MANY_LENS they end at its old length
+	// at the latest
+	const char *end = str->str + oldLen;
+	char *p = str->str + oldLen;
+	size_t left = total;
+	va_copy(args, ap);
+	for (size_t i = 0; left > 0 && (s = va_arg(args, const char *)) != NULL; i++) {
+		s = strRebase(str, s, old, oldCap);
+		size_t n;
+		if (i < MANY_LENS) {
+			n = lens[i];
+		} else if (s >= str->str && s <= end) {
+			const char *nul = memchr(s, '\0', end - s);
+			n = (nul ? nul : end) - s;
+		} else {
+			n = strlen(s);
+		}
+		if (n > left)
+			n = left;
+		memcpy(p, s, n);
+		p += n;
+		left -= n;
+	}
+	va_end(args);
+	*p = '\0';
+	STAT(bytesCopied, total - left);
+	str->len += total - left;
+}
+
+void xStrAppendViews(xStr *str, const xStrView *parts, xStrSize count)
+{
+	STAT_SITE(XSTR_SITE_INSERT);
+	xStrSize total = 0;
+	for (xStrSize i = 0; i < count; i++) {
+		if (parts[i].len < 0 || parts[i].len > XSTR_SIZE_MAX - 1 - str->len - total)
+			return;
+		total += parts[i].len;
+	}
+	const char *old = str->str;
+	const xStrSize oldCap = strCap(str);
+	if (!xStrEnsureCap(str, str->len + total + 1))
+		return;
+	char *p = str->str + str->len;
+	for (xStrSize i = 0; i < count; i++) {
+		memcpy(p, strRebase(str, parts[i].str, old, oldCap), parts[i].len);
+		p += parts[i].len;
+	}
+	*p = '\0';
+	STAT(bytesCopied, total);
+	str->len += total;
+}
+
+void xStrErase(xStr *str, xStrSize pos, xStrSize len)
+{
+	STAT_SITE(XSTR_SITE_ERASE);
+	if (pos < 0 || pos >= str->len || len == 0 || len < -1)
+		return;
+	if (len == -1)
+		len = str->len - pos;
+	if (!strUnshare(str, str->len + 1))
+		return;
+	xStrSize end;
+	if (len > str->len - pos)
+		end = str->len;
+	else
+		end = pos + len;
+	if (end == str->len) {
+		str->str[pos] = '\0';
+		str->len = pos;
+	} else {
+		memmove(str->str + pos, str->str + end, str->len - end);
+		STAT(bytesCopied, str->len - end);
+		str->len -= len;
+		str->str[str->len] = '\0';
+	}
+	strShrink(str);
+}
+
+void xStrOverwrite(xStr *str, xStrSize pos, xStrSize len, const char *s)
+{
+	xStrOverwriteLen(str, pos, len, s, -1);
+}
+
+void xStrOverwriteLen(xStr *str, xStrSize pos, xStrSize len, const char *s, xStrSize slen)
+{
+	STAT_SITE(XSTR_SITE_OVERWRITE);
+	if (s && slen < 0)
+		slen = strlen(s);
+	// a range replaced by as many bytes is written where it is, without
+	// moving the rest of the string twice; s may point into str
+	if (s && pos >= 0 && slen > 0 && len == slen && slen <= str->len - pos) {
+		if (!strUnshare(str, str->len + 1))
+			return;
+		memmove(str->str + pos, s, slen);
+		STAT(bytesCopied, slen);
+		return;
+	}
+	xStrErase(str, pos, len);
+	if (s && slen > 0)
+		xStrInsertLen(str, pos, s, slen);
+}
+
+void xStrOverwriteCh(xStr *str, xStrSize pos, xStrSize len, char ch)
+{
+	xStrOverwriteLen(str, pos, len, &ch, 1);
+}
+
+void xStrOverwriteFmt(xStr *str, xStrSize pos, xStrSize len, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	xStrOverwriteFmtV(str, pos, len, fmt, ap);
+	va_end(ap);
+}
+
+void xStrOverwriteFmtV(xStr *str, xStrSize pos, xStrSize len, const char *fmt,
+	va_list ap)
+{
+	STAT_SITE(XSTR_SITE_OVERWRITE);
+	char stack[256];
+	va_list args;
+
+	// short results go through xStrOverwriteLen() so a same-sized one is
+	// written in place; longer ones are formatted straight into str
+	va_copy(args, ap);
+	const int size = vsnprintf(stack, sizeof(stack), fmt, args);
+	va_end(args);
+	if (size >= 0 && size < (int)sizeof(stack)) {
+		xStrOverwriteLen(str, pos, len, stack, size);
+		return;
+	}
+	xStrErase(str, pos, len);
+	xStrInsertFmtV(str, pos, fmt, ap);
+}
+
+static size_t twoWay(const unsigned char *h, size_t hlen,
+	const unsigned char *n, size_t m, const int reverse);
+
+static const char *strFind(const char *hay, size_t hayLen, const char *needle,
+	size_t needleLen)
+{
+	if (needleLen == 0 || needleLen > hayLen)
+		return NULL;
+	if (needleLen == 1)
+		return memchr(hay, needle[0], hayLen);
+	if (needleLen > 3) {
+		size_t pos = twoWay((const unsigned char *)hay, hayLen,
+			(const unsigned char *)needle, needleLen, 0);
+		return (pos == (size_t)-1) ? NULL : hay + pos;
+	}
+	const char *p = hay;
+	const char *last = hay + (hayLen - needleLen);
+	while (p <= last) {
+		p = memchr(p, needle[0], (last - p) + 1);
+		if (!p)
+			return NULL;
+		if (memcmp(p + 1, needle + 1, needleLen - 1) == 0)
+			return p;
+		p++;
+	}
+	return NULL;
+}
+
+void xStrReplace(xStr *str, const char *needle, const char *repl,
+	xStrSize maxReplace)
+{
+	if (!needle || !repl)
+		return;
+	xStrReplaceLen(str, needle, strlen(needle), repl, strlen(repl), maxReplace);
+}
+
+void xStrReplaceLen(xStr *str, const char *needle, xStrSize needleLen,
+	const char *repl, xStrSize replLen, xStrSize maxReplace)
+{
+	STAT_SITE(XSTR_SITE_REPLACE);
+	if (!needle || !repl || needleLen <= 0 || replLen < 0 || maxReplace < 0
+		|| str->len == 0)
+		return;
+
+	// collect all match offsets first so the result is built in one pass
+	xStrSize stackMatches[64];
+	xStrSize *matches = stackMatches;
+	xStrSize matchCap = 64;
+	xStrSize numMatches = 0;
+	const char *end = str->str + str->len;
+	const char *p = str->str;
+	while ((maxReplace < 1 || numMatches < maxReplace)
+		&& (p = strFind(p, end - p, needle, needleLen)) != NULL) {
+		if (numMatches == matchCap) {
+			xStrSize *tmp = strAlloc(str->alloc, matchCap * 2 * sizeof(xStrSize));
+			if (!tmp)
+				goto out;
+			memcpy(tmp, matches, numMatches * sizeof(xStrSize));
+			if (matches != stackMatches)
+				strFree(str->alloc, matches, matchCap * sizeof(xStrSize));
+			matches = tmp;
+			matchCap *= 2;
+		}
+		matches[numMatches++] = p - str->str;
+		p += needleLen;
+	}
+	if (numMatches == 0)
+		goto out;
+
+	if (replLen <= needleLen) {
+		if (!strUnshare(str, str->len + 1))
+			goto out;
+		end = str->str + str->len;
+		char *w = str->str + matches[0];
+		for (xStrSize i = 0; i < numMatches; i++) {
+			const char *r = str->str + matches[i] + needleLen;
+			memcpy(w, repl, replLen);
+			w += replLen;
+			const char *next = (i + 1 < numMatches) ? str->str + matches[i + 1] : end;
+			memmove(w, r, next - r);
+			w += next - r;
+		}
+		*w = '\0';
+		STAT(bytesCopied, w - (str->str + matches[0]));
+		str->len = w - str->str;
+		strShrink(str);
+		goto out;
+	}
+
+	const xStrSize grow = replLen - needleLen;
+	if (numMatches > (XSTR_SIZE_MAX - 1 - str->len) / grow)
+		goto out;
+	const xStrSize nlen = str->len + numMatches * grow;
+
+	const int shared = strShared(str) != NULL;
+	if (nlen + 1 <= strCap(str) && (!shared || strSoleOwner(str))) {
+		// enough room: shift segments right, working back from the end
+		if (shared)
+			strReclaim(str);
+		char *w = str->str + nlen;
+		const char *r = end;
+		*w = '\0';
+		for (xStrSize i = numMatches - 1; i >= 0; i--) {
+			const char *m = str->str + matches[i];
+			const xStrSize seg = r - (m + needleLen);
+			w -= seg;
+			memmove(w, m + needleLen, seg);
+			w -= replLen;
+			memcpy(w, repl, replLen);
+			r = m;
+		}
+		STAT(bytesCopied, nlen - matches[0]);
+	} else {
+		char *nstr = strAlloc(str->alloc, nlen + 1);
+		if (!nstr)
+			goto out;
+		char *w = nstr;
+		const char *r = str->str;
+		for (xStrSize i = 0; i < numMatches; i++) {
+			const char *m = str->str + matches[i];
+			memcpy(w, r, m - r);
+			w += m - r;
+			memcpy(w, repl, replLen);
+			w += replLen;
+			r = m + needleLen;
+		}
+		memcpy(w, r, (end - r) + 1);
+		STAT(bytesCopied, nlen + 1);
+		strDropBuffer(str);
+		str->str = nstr;
+		str->cap = strUsableCap(str, nlen + 1);
+	}
+	str->len = nlen;
+
+out:
+	if (matches != stackMatches)
+		strFree(str->alloc, matches, matchCap * sizeof(xStrSize));
+}
+
+static void strCharSet(unsigned char set[32], const char *chrs)
+{
+	memset(set, 0, 32);
+	for (const unsigned char *p = (const unsigned char *)chrs; *p; p++)
+		set[*p >> 3] |= 1 << (*p & 7);
+}
+
+#define CHARSET_HAS(set, c) ((set)[(unsigned char)(c) >> 3] & (1 << ((unsigned char)(c)&7)))
+
+void xStrStripFront(xStr *str, const char *chrs)
+{
+	unsigned char set[32];
+	strCharSet(set, chrs ? chrs : WS_CHARS);
+	xStrSize start = 0;
+	while (start < str->len && CHARSET_HAS(set, str->str[start]))
+		start++;
+	if (start > 0 && strUnshare(str, str->len + 1)) {
+		memmove(str->str, str->str + start, (str->len - start) + 1);
+		STAT(bytesCopied, str->len - start);
+		str->len -= start;
+		strShrink(str);
+	}
+}
+
+void xStrStripBack(xStr *str, const char *chrs)
+{
+	unsigned char set[32];
+	strCharSet(set, chrs ? chrs : WS_CHARS);
+	xStrSize len = str->len;
+	while (len > 0 && CHARSET_HAS(set, str->str[len - 1]))
+		len--;
+	if (len == str->len || !strUnshare(str, str->len + 1))
+		return;
+	str->str[len] = '\0';
+	str->len = len;
+	strShrink(str);
+}
+
+void xStrStrip(xStr *str, const char *chrs)
+{
+	xStrStripFront(str, chrs);
+	xStrStripBack(str, chrs);
+}
+
+// NULL sorts after everything else
+static int strNullCompare(const void *p1, const void *p2)
+{
+	if (p1 == p2)
+		return 0;
+	return (p1 ? -1 : 1);
+}
+
+static int strCompare(const char *s1, xStrSize len1, const char *s2,
+	xStrSize len2)
+{
+	int res = memcmp(s1, s2, MIN(len1, len2));
+	if (res != 0)
+		return res;
+	return (len1 > len2) - (len1 < len2);
+}
+
+int xStrCompare(const xStr *str1, const xStr *str2)
+{
+	if (!str1 || !str2)
+		return strNullCompare(str1, str2);
+	else if (!str1->str || !str2->str)
+		return strNullCompare(str1->str, str2->str);
+	return strCompare(str1->str, str1->len, str2->str, str2->len);
+}
+
+#define ONES64 0x0101010101010101ull
+#define HIGH64 0x8080808080808080ull
+
+static unsigned char asciiLower(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? (c | 0x20) : c;
+}
+
+// Flips the case bit of every byte of w in the range [lo, hi].
+static uint64_t caseFlip64(uint64_t w, unsigned char lo, unsigned char hi)
+{
+	const uint64_t h = w & ~HIGH64;
+	const uint64_t ge = h + ONES64 * (0x80 - lo);
+	const uint64_t gt = h + ONES64 * (0x80 - hi - 1);
+	return w ^ (((ge ^ gt) & ~w & HIGH64) >> 2);
+}
+
+static void caseMapSWAR(unsigned char *p, size_t n, unsigned char lo,
+	unsigned char hi)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		uint64_t w;
+		memcpy(&w, p + i, 8);
+		w = caseFlip64(w, lo, hi);
+		memcpy(p + i, &w, 8);
+	}
+	for (; i < n; i++) {
+		if (p[i] >= lo && p[i] <= hi)
+			p[i] ^= 0x20;
+	}
+}
+
+static size_t caseMismatchSWAR(const unsigned char *a, const unsigned char *b,
+	size_t n)
+{
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x, y;
+		memcpy(&x, a + i, 8);
+		memcpy(&y, b + i, 8);
+		if (x != y && caseFlip64(x, 'A', 'Z') != caseFlip64(y, 'A', 'Z'))
+			break;
+	}
+	for (; i < n; i++) {
+		if (asciiLower(a[i]) != asciiLower(b[i]))
+			return i;
+	}
+	return n;
+}
+
+static const char *findLastChSWAR(const char *p, size_t n, char c)
+{
+	const uint64_t pattern = ONES64 * (unsigned char)c;
+	while (n >= 8) {
+		uint64_t w;
+		memcpy(&w, p + n - 8, 8);
+		w ^= pattern;
+		if ((w - ONES64) & ~w & HIGH64)
+			break;
+		n -= 8;
+	}
+	while (n--) {
+		if (p[n] == c)
+			return p + n;
+	}
+	return NULL;
+}
+
+#ifdef XSTR_X86
+__attribute__((target("sse2"))) static void caseMapSSE2(unsigned char *p,
+	size_t n, unsigned char lo, unsigned char hi)
+{
+	const __m128i shift = _mm_set1_epi8((char)(0x80 - lo));
+	const __m128i limit = _mm_set1_epi8((char)(-128 + (hi - lo + 1)));
+	const __m128i flip = _mm_set1_epi8(0x20);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		__m128i in = _mm_cmplt_epi8(_mm_add_epi8(v, shift), limit);
+		v = _mm_xor_si128(v, _mm_and_si128(in, flip));
+		_mm_storeu_si128((__m128i *)(p + i), v);
+	}
+	caseMapSWAR(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("sse2"))) static size_t caseMismatchSSE2(
+	const unsigned char *a, const unsigned char *b, size_t n)
+{
+	const __m128i shift = _mm_set1_epi8((char)(0x80 - 'A'));
+	const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+	const __m128i flip = _mm_set1_epi8(0x20);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+		x = _mm_or_si128(x, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(x, shift), limit), flip));
+		y = _mm_or_si128(y, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(y, shift), limit), flip));
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+		if (mask != 0xffff)
+			return i + __builtin_ctz(~mask);
+	}
+	return i + caseMismatchSWAR(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void caseMapAVX2(unsigned char *p,
+	size_t n, unsigned char lo, unsigned char hi)
+{
+	const __m256i shift = _mm256_set1_epi8((char)(0x80 - lo));
+	const __m256i limit = _mm256_set1_epi8((char)(-128 + (hi - lo + 1)));
+	const __m256i flip = _mm256_set1_epi8(0x20);
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+		__m256i in = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, shift));
+		v = _mm256_xor_si256(v, _mm256_and_si256(in, flip));
+		_mm256_storeu_si256((__m256i *)(p + i), v);
+	}
+	caseMapSSE2(p + i, n - i, lo, hi);
+}
+
+__attribute__((target("avx2"))) static size_t caseMismatchAVX2(
+	const unsigned char *a, const unsigned char *b, size_t n)
+{
+	const __m256i shift = _mm256_set1_epi8((char)(0x80 - 'A'));
+	const __m256i limit = _mm256_set1_epi8((char)(-128 + 26));
+	const __m256i flip = _mm256_set1_epi8(0x20);
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+		x = _mm256_or_si256(x, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, shift)), flip));
+		y = _mm256_or_si256(y, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(y, shift)), flip));
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+		if (mask != 0xffffffffu)
+			return i + __builtin_ctz(~mask);
+	}
+	return i + caseMismatchSSE2(a + i, b + i, n - i);
+}
+
+__attribute__((target("sse2"))) static const char *findLastChSSE2(
+	const char *p, size_t n, char c)
+{
+	const __m128i pattern = _mm_set1_epi8(c);
+	while (n >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + n - 16));
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, pattern));
+		if (mask)
+			return p + n - 16 + (31 - __builtin_clz(mask));
+		n -= 16;
+	}
+	return findLastChSWAR(p, n, c);
+}
+
+__attribute__((target("avx2"))) static const char *findLastChAVX2(
+	const char *p, size_t n, char c)
+{
+	const __m256i pattern = _mm256_set1_epi8(c);
+	while (n >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(p + n - 32));
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, pattern));
+		if (mask)
+			return p + n - 32 + (31 - __builtin_clz(mask));
+		n -= 32;
+	}
+	return findLastChSSE2(p, n, c);
+}
+#endif
+
+static void caseMapResolve(unsigned char *p, size_t n, unsigned char lo,
+	unsigned char hi);
+static size_t caseMismatchResolve(const unsigned char *a,
+	const unsigned char *b, size_t n);
+static const char *findLastChResolve(const char *p, size_t n, char c);
+
+static void (*caseMapImpl)(unsigned char *, size_t, unsigned char,
+	unsigned char)
+	= caseMapResolve;
+static size_t (*caseMismatchImpl)(const unsigned char *,
+	const unsigned char *, size_t)
+	= caseMismatchResolve;
+static const char *(*findLastChImpl)(const char *, size_t, char)
+	= findLastChResolve;
+
+// Threads may race to resolve the kernels; they all store the same values,
+// so relaxed atomics are enough to make that well defined.
+#ifdef __GNUC__
+#define IMPL_LOAD(p) __atomic_load_n(&(p), __ATOMIC_RELAXED)
+#define IMPL_STORE(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELAXED)
+#else
+#define IMPL_LOAD(p) (p)
+#define IMPL_STORE(p, v) ((p) = (v))
+#endif
+
+// Picks the widest kernels the CPU supports on first use.
+static void simdResolve(void)
+{
+	void (*caseMap)(unsigned char *, size_t, unsigned char, unsigned char)
+		= caseMapSWAR;
+	size_t (*caseMismatch)(const unsigned char *, const unsigned char *, size_t)
+		= caseMismatchSWAR;
+	const char *(*findLastCh)(const char *, size_t, char) = findLastChSWAR;
+#ifdef XSTR_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		caseMap = caseMapAVX2;
+		caseMismatch = caseMismatchAVX2;
+		findLastCh = findLastChAVX2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		caseMap = caseMapSSE2;
+		caseMismatch = caseMismatchSSE2;
+		findLastCh = findLastChSSE2;
+	}
+#endif
+	IMPL_STORE(caseMapImpl, caseMap);
+	IMPL_STORE(caseMismatchImpl, caseMismatch);
+	IMPL_STORE(findLastChImpl, findLastCh);
+}
+
+static void caseMapResolve(unsigned char *p, size_t n, unsigned char lo,
+	unsigned char hi)
+{
+	simdResolve();
+	IMPL_LOAD(caseMapImpl)(p, n, lo, hi);
+}
+
+static size_t caseMismatchResolve(const unsigned char *a,
+	const unsigned char *b, size_t n)
+{
+	simdResolve();
+	return IMPL_LOAD(caseMismatchImpl)(a, b, n);
+}
+
+static const char *findLastChResolve(const char *p, size_t n, char c)
+{
+	simdResolve();
+	return IMPL_LOAD(findLastChImpl)(p, n, c);
+}
+
+#define TW_NOT_FOUND ((size_t)-1)
+#define TW_H(i) (reverse ? h[hlen - 1 - (i)] : h[i])
+#define TW_N(i) (reverse ? n[m - 1 - (i)] : n[i])
+
+// Crochemore-Perrin Two-Way search, linear time and constant space. With
+// reverse set, both strings are read back to front, so the result is the
+// offset of the last match counted from the end of the haystack.
+static size_t twoWay(const unsigned char *h, size_t hlen,
+	const unsigned char *n, size_t m, const int reverse)
+{
+	size_t i, ip, jp, k, p, ms, p0, mem, mem0, pos;
+	size_t byteset[256 / (8 * sizeof(size_t))] = { 0 };
+	size_t shift[256];
+	const size_t bits = 8 * sizeof(size_t);
+
+	for (i = 0; i < m; i++) {
+		const unsigned char ch = TW_N(i);
+		byteset[ch / bits] |= (size_t)1 << (ch % bits);
+		shift[ch] = i + 1;
+	}
+
+	// maximal suffix for <
+	ip = TW_NOT_FOUND;
+	jp = 0;
+	k = p = 1;
+	while (jp + k < m) {
+		const unsigned char a = TW_N(ip + k), b = TW_N(jp + k);
+		if (a == b) {
+			if (k == p) {
+				jp += p;
+				k = 1;
+			} else {
+				k++;
+			}
+		} else if (a > b) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+	ms = ip;
+	p0 = p;
+
+	// and for >
+	ip = TW_NOT_FOUND;
+	jp = 0;
+	k = p = 1;
+	while (jp + k < m) {
+		const unsigned char a = TW_N(ip + k), b = TW_N(jp + k);
+		if (a == b) {
+			if (k == p) {
+				jp += p;
+				k = 1;
+			} else {
+				k++;
+			}
+		} else if (a < b) {
+			jp += k;
+			k = 1;
+			p = jp - ip;
+		} else {
+			ip = jp++;
+			k = p = 1;
+		}
+	}
+	if (ip + 1 > ms + 1)
+		ms = ip;
+	else
+		p = p0;
+
+	// periodic needle?
+	for (i = 0; i < ms + 1 && TW_N(i) == TW_N(i + p); i++)
+		;
+	if (i < ms + 1) {
+		mem0 = 0;
+		p = MAX(ms, m - ms - 1) + 1;
+	} else {
+		mem0 = m - p;
+	}
+	mem = 0;
+
+	for (pos = 0; hlen - pos >= m;) {
+		const unsigned char last = TW_H(pos + m - 1);
+		if (!(byteset[last / bits] & ((size_t)1 << (last % bits)))) {
+			pos += m;
+			mem = 0;
+			continue;
+		}
+		k = m - shift[last];
+		if (k) {
+			if (mem0 && mem && k < p)
+				k = m - p;
+			pos += k;
+			mem = 0;
+			continue;
+		}
+		for (k = MAX(ms + 1, mem); k < m && TW_N(k) == TW_H(pos + k); k++)
+			;
+		if (k < m) {
+			pos += k - ms;
+			mem = 0;
+			continue;
+		}
+		for (k = ms + 1; k > mem && TW_N(k - 1) == TW_H(pos + k - 1); k--)
+			;
+		if (k <= mem)
+			return pos;
+		pos += p;
+		mem = mem0;
+	}
+	return TW_NOT_FOUND;
+}
+
+static const char *strFindLast(const char *hay, size_t hayLen,
+	const char *needle, size_t needleLen)
+{
+	if (needleLen == 0 || needleLen > hayLen)
+		return NULL;
+	if (needleLen == 1)
+		return IMPL_LOAD(findLastChImpl)(hay, hayLen, needle[0]);
+	size_t pos = twoWay((const unsigned char *)hay, hayLen,
+		(const unsigned char *)needle, needleLen, 1);
+	if (pos == TW_NOT_FOUND)
+		return NULL;
+	return hay + (hayLen - pos - needleLen);
+}
+
+static int strCaseCompare(const char *s1, xStrSize len1, const char *s2,
+	xStrSize len2)
+{
+	const unsigned char *p1 = (const unsigned char *)s1;
+	const unsigned char *p2 = (const unsigned char *)s2;
+	const size_t n = MIN(len1, len2);
+	const size_t i = (p1 == p2) ? n : IMPL_LOAD(caseMismatchImpl)(p1, p2, n);
+	if (i < n)
+		return asciiLower(p1[i]) - asciiLower(p2[i]);
+	return (len1 > len2) - (len1 < len2);
+}
+
+static int strCaseCompareLocale(const xStr *str1, const xStr *str2)
+{
+	const unsigned char *p1 = (const unsigned char *)str1->str;
+	const unsigned char *p2 = (const unsigned char *)str2->str;
+	const xStrSize n = MIN(str1->len, str2->len);
+	for (xStrSize i = 0; i < n; i++) {
+		int c1 = tolower(p1[i]), c2 = tolower(p2[i]);
+		if (c1 != c2)
+			return c1 - c2;
+	}
+	return (str1->len > str2->len) - (str1->len < str2->len);
+}
+
+int xStrCaseCompare(const xStr *str1, const xStr *str2)
+{
+	if (!str1 || !str2)
+		return strNullCompare(str1, str2);
+	else if (!str1->str || !str2->str)
+		return strNullCompare(str1->str, str2->str);
+	else
+		return strCaseCompare(str1->str, str1->len, str2->str, str2->len);
+}
+
+int xStrCaseCompareLocale(const xStr *str1, const xStr *str2)
+{
+	if (!str1 || !str2)
+		return strNullCompare(str1, str2);
+	else if (!str1->str || !str2->str)
+		return strNullCompare(str1->str, str2->str);
+	else
+		return strCaseCompareLocale(str1, str2);
+}
+
+int xStrEqual(const xStr *str1, const xStr *str2)
+{
+	if (str1 && str2 && str1->len != str2->len)
+		return 0;
+	return (xStrCompare(str1, str2) == 0);
+}
+
+void xStrToUpper(xStr *str)
+{
+	if (!strUnshare(str, str->len + 1))
+		return;
+	IMPL_LOAD(caseMapImpl)((unsigned char *)str->str, str->len, 'a', 'z');
+}
+
+void xStrToLower(xStr *str)
+{
+	if (!strUnshare(str, str->len + 1))
+		return;
+	IMPL_LOAD(caseMapImpl)((unsigned char *)str->str, str->len, 'A', 'Z');
+}
+
+void xStrToUpperLocale(xStr *str)
+{
+	if (!strUnshare(str, str->len + 1))
+		return;
+	for (xStrSize i = 0; i < str->len; i++)
+		str->str[i] = toupper((unsigned char)str->str[i]);
+}
+
+void xStrToLowerLocale(xStr *str)
+{
+	if (!strUnshare(str, str->len + 1))
+		return;
+	for (xStrSize i = 0; i < str->len; i++)
+		str->str[i] = tolower((unsigned char)str->str[i]);
+}
+
+xStrSize xStrFirstIndexOf(const xStr *str, const char *s)
+{
+	if (!s)
+		return -1;
+	return xStrFirstIndexOfLen(str, s, strlen(s));
+}
+
+xStrSize xStrFirstIndexOfLen(const xStr *str, const char *s, xStrSize len)
+{
+	if (!s || len <= 0)
+		return -1;
+	return xStrViewFirstIndexOf(xStrViewOf(str), xStrViewMake(s, len));
+}
+
+xStrSize xStrFirstIndexOfCh(const xStr *str, char c)
+{
+	return xStrFirstIndexOfLen(str, &c, 1);
+}
+
+xStrSize xStrLastIndexOf(const xStr *str, const char *s)
+{
+	if (!s)
+		return -1;
+	return xStrLastIndexOfLen(str, s, strlen(s));
+}
+
+xStrSize xStrLastIndexOfLen(const xStr *str, const char *s, xStrSize len)
+{
+	if (!s || len <= 0)
+		return -1;
+	return xStrViewLastIndexOf(xStrViewOf(str), xStrViewMake(s, len));
+}
+
+xStrSize xStrLastIndexOfCh(const xStr *str, char c)
+{
+	return xStrViewLastIndexOfCh(xStrViewOf(str), c);
+}
+
+// Grows str to len bytes, placing the current contents after left fill bytes
+// and filling the remainder on the right.
+static void strPad(xStr *str, xStrSize len, xStrSize left, char fill)
+{
+	STAT_SITE(XSTR_SITE_PAD);
+	if (len >= XSTR_SIZE_MAX || !xStrEnsureCap(str, len + 1))
+		return;
+	if (left > 0) {
+		memmove(str->str + left, str->str, str->len);
+		STAT(bytesCopied, str->len);
+		memset(str->str, fill, left);
+	}
+	memset(str->str + left + str->len, fill, len - left - str->len);
+	str->len = len;
+	str->str[len] = '\0';
+}
+
+void xStrLeftJustify(xStr *str, xStrSize len, char fill)
+{
+	if (len <= str->len)
+		return;
+	strPad(str, len, 0, fill);
+}
+
+void xStrRightJustify(xStr *str, xStrSize len, char fill)
 {
-	if (!str1 || !str2)
-		return (str1 - str2);
-	else if (!str1->str || !str2->str)
-		return (str1->str - str2->str);
+	if (len <= str->len)
+		return;
+	strPad(str, len, len - str->len, fill);
+}
+
+void xStrCenter(xStr *str, xStrSize len, char fill)
+{
+	if (len <= str->len)
+		return;
+	strPad(str, len, (len / 2) - (str->len / 2), fill);
+}
+
+int xStrStartsWith(const xStr *str, const char *s)
+{
+	if (!s)
+		return 0;
+	return xStrStartsWithLen(str, s, strlen(s));
+}
+
+int xStrStartsWithLen(const xStr *str, const char *s, xStrSize len)
+{
+	if (!s || len <= 0)
+		return 0;
+	return xStrViewStartsWith(xStrViewOf(str), xStrViewMake(s, len));
+}
+
+int xStrEndsWith(const xStr *str, const char *s)
+{
+	if (!s)
+		return 0;
+	return xStrEndsWithLen(str, s, strlen(s));
+}
+
+int xStrEndsWithLen(const xStr *str, const char *s, xStrSize len)
+{
+	if (!s || len <= 0)
+		return 0;
+	return xStrViewEndsWith(xStrViewOf(str), xStrViewMake(s, len));
+}
+
+xStrView xStrViewMake(const char *s, xStrSize len)
+{
+	xStrView view = { s, 0 };
+	if (s)
+		view.len = (len < 0) ? (xStrSize)strlen(s) : len;
 	else
-		return strCaseCompare(str1->str, str2->str);
+		view.str = "";
+	return view;
 }
 
-int xStrEqual(const xStr *str1, const xStr *str2)
+xStrView xStrViewOf(const xStr *str)
 {
-	return (xStrCompare(str1, str2) == 0);
+	xStrView view = { str->str, str->len };
+	return view;
 }
 
-void xStrToUpper(xStr *str)
+xStrView xStrSlice(const xStr *str, xStrSize pos, xStrSize len)
 {
-	for (int i = 0; i < str->len; i++)
-		str->str[i] = toupper(str->str[i]);
+	return xStrViewSlice(xStrViewOf(str), pos, len);
 }
 
-void xStrToLower(xStr *str)
+xStrView xStrViewSlice(xStrView view, xStrSize pos, xStrSize len)
+{
+	pos = MAX(0, MIN(pos, view.len));
+	if (len < 0 || len > view.len - pos)
+		len = view.len - pos;
+	view.str += pos;
+	view.len = len;
+	return view;
+}
+
+xStrSize xStrViewFirstIndexOf(xStrView view, xStrView s)
 {
-	for (int i = 0; i < str->len; i++)
-		str->str[i] = tolower(str->str[i]);
+	const char *found = strFind(view.str, view.len, s.str, s.len);
+	if (!found)
+		return -1;
+	return (found - view.str);
 }
 
-int xStrFirstIndexOf(const xStr *str, const char *s)
+xStrSize xStrViewFirstIndexOfCh(xStrView view, char c)
 {
-	if (!s || s[0] == '\0')
+	const char *found = memchr(view.str, c, view.len);
+	if (!found)
 		return -1;
-	return strFirstIndexOf(str->str, s);
+	return (found - view.str);
 }
 
-int xStrFirstIndexOfCh(const xStr *str, char c)
+xStrSize xStrViewLastIndexOf(xStrView view, xStrView s)
 {
-	char buf[2] = { c, 0 };
-	return xStrFirstIndexOf(str, buf);
+	const char *found = strFindLast(view.str, view.len, s.str, s.len);
+	if (!found)
+		return -1;
+	return (found - view.str);
 }
 
-int xStrLastIndexOf(const xStr *str, const char *s)
+xStrSize xStrViewLastIndexOfCh(xStrView view, char c)
 {
-	if (!s || s[0] == '\0')
+	const char *found = IMPL_LOAD(findLastChImpl)(view.str, view.len, c);
+	if (!found)
 		return -1;
-	int len = strlen(s);
-	const char *off = (str->str + str->len) - len;
-	while (off >= str->str) {
-		const char *found = strstr(off, s);
-		if (found)
-			return (found - str->str);
-		off--;
+	return (found - view.str);
+}
+
+int xStrViewCompare(xStrView view1, xStrView view2)
+{
+	return strCompare(view1.str, view1.len, view2.str, view2.len);
+}
+
+int xStrViewCaseCompare(xStrView view1, xStrView view2)
+{
+	return strCaseCompare(view1.str, view1.len, view2.str, view2.len);
+}
+
+int xStrViewEqual(xStrView view1, xStrView view2)
+{
+	return (view1.len == view2.len && memcmp(view1.str, view2.str, view1.len) == 0);
+}
+
+int xStrViewStartsWith(xStrView view, xStrView s)
+{
+	if (s.len <= 0 || s.len > view.len)
+		return 0;
+	return (memcmp(view.str, s.str, s.len) == 0);
+}
+
+int xStrViewEndsWith(xStrView view, xStrView s)
+{
+	if (s.len <= 0 || s.len > view.len)
+		return 0;
+	return (memcmp(view.str + (view.len - s.len), s.str, s.len) == 0);
+}
+
+xStrView xStrViewStripFront(xStrView view, const char *chrs)
+{
+	unsigned char set[32];
+	strCharSet(set, chrs ? chrs : WS_CHARS);
+	while (view.len > 0 && CHARSET_HAS(set, view.str[0])) {
+		view.str++;
+		view.len--;
 	}
-	return -1;
+	return view;
 }
 
-int xStrLastIndexOfCh(const xStr *str, char c)
+xStrView xStrViewStripBack(xStrView view, const char *chrs)
 {
-	char buf[2] = { c, 0 };
-	return xStrLastIndexOf(str, buf);
+	unsigned char set[32];
+	strCharSet(set, chrs ? chrs : WS_CHARS);
+	while (view.len > 0 && CHARSET_HAS(set, view.str[view.len - 1]))
+		view.len--;
+	return view;
 }
 
-void xStrLeftJustify(xStr *str, int len, char fill)
+xStrView xStrViewStrip(xStrView view, const char *chrs)
 {
-	if (len <= str->len)
+	return xStrViewStripBack(xStrViewStripFront(view, chrs), chrs);
+}
+
+void xStrInitView(xStr *str, xStrView view)
+{
+	xStrInitLen(str, view.str, view.len);
+}
+
+void xStrAssignView(xStr *str, xStrView view)
+{
+	xStrAssignLen(str, view.str, view.len);
+}
+
+void xStrInsertView(xStr *str, xStrSize pos, xStrView view)
+{
+	xStrInsertLen(str, pos, view.str, view.len);
+}
+
+void xStrAppendView(xStr *str, xStrView view)
+{
+	xStrInsertLen(str, str->len, view.str, view.len);
+}
+
+enum {
+	SPLIT_CH,
+	SPLIT_STR,
+	SPLIT_ANY
+};
+
+void xStrSplitInitCh(xStrSplitIter *it, xStrView src, char delim)
+{
+	it->rest = src;
+	it->delim = xStrViewMake(NULL, 0);
+	it->ch = delim;
+	it->mode = SPLIT_CH;
+	it->done = 0;
+}
+
+void xStrSplitInitStr(xStrSplitIter *it, xStrView src, xStrView delim)
+{
+	it->rest = src;
+	it->delim = delim;
+	it->ch = '\0';
+	it->mode = SPLIT_STR;
+	it->done = 0;
+}
+
+void xStrSplitInitAny(xStrSplitIter *it, xStrView src, const char *chrs)
+{
+	it->rest = src;
+	it->delim = xStrViewMake(NULL, 0);
+	it->ch = '\0';
+	strCharSet(it->set, chrs ? chrs : WS_CHARS);
+	it->mode = SPLIT_ANY;
+	it->done = 0;
+}
+
+int xStrSplitNext(xStrSplitIter *it, xStrView *field)
+{
+	if (it->done)
+		return 0;
+
+	xStrSize idx = -1, skip = 1;
+	switch (it->mode) {
+	case SPLIT_CH:
+		idx = xStrViewFirstIndexOfCh(it->rest, it->ch);
+		break;
+	case SPLIT_STR:
+		idx = xStrViewFirstIndexOf(it->rest, it->delim);
+		skip = it->delim.len;
+		break;
+	case SPLIT_ANY:
+		for (idx = 0; idx < it->rest.len && !CHARSET_HAS(it->set, it->rest.str[idx]); idx++)
+			;
+		if (idx == it->rest.len)
+			idx = -1;
+		break;
+	}
+
+	if (idx < 0) {
+		*field = it->rest;
+		it->done = 1;
+	} else {
+		*field = xStrViewSlice(it->rest, 0, idx);
+		it->rest = xStrViewSlice(it->rest, idx + skip, -1);
+	}
+	return 1;
+}
+
+static int strOverlaps(const xStr *str, xStrView view)
+{
+	return (view.str >= str->str && view.str < str->str + strCap(str));
+}
+
+void xStrJoin(xStr *str, xStrView sep, const xStrView *parts, xStrSize count)
+{
+	STAT_SITE(XSTR_SITE_JOIN);
+	xStrSize total = 0;
+	int overlap = strOverlaps(str, sep);
+	for (xStrSize i = 0; i < count; i++) {
+		xStrSize n = parts[i].len + (i > 0 ? sep.len : 0);
+		if (n > XSTR_SIZE_MAX - 1 - total)
+			return;
+		total += n;
+		overlap |= strOverlaps(str, parts[i]);
+	}
+
+	// parts taken from str itself are joined into a fresh buffer
+	xStr tmp;
+	xStr *out = str;
+	if (overlap) {
+		xStrInitAlloc(&tmp, NULL, str->alloc);
+		out = &tmp;
+	}
+
+	xStrClear(out);
+	if (!xStrEnsureCap(out, total + 1)) {
+		if (overlap)
+			xStrCleanup(&tmp);
 		return;
-	const int diff = len - str->len;
-	for (int i = 0; i < diff; i++)
-		xStrAppendCh(str, fill);
+	}
+	char *p = out->str;
+	for (xStrSize i = 0; i < count; i++) {
+		if (i > 0) {
+			memcpy(p, sep.str, sep.len);
+			p += sep.len;
+		}
+		memcpy(p, parts[i].str, parts[i].len);
+		p += parts[i].len;
+	}
+	*p = '\0';
+	STAT(bytesCopied, total);
+	out->len = total;
+
+	if (overlap) {
+		xStrSwap(str, &tmp);
+		xStrCleanup(&tmp);
+	}
 }
 
-void xStrRightJustify(xStr *str, int len, char fill)
+void xStrJoinStrs(xStr *str, xStrView sep, const xStr *parts, xStrSize count)
 {
-	if (len <= str->len)
+	STAT_SITE(XSTR_SITE_JOIN);
+	xStrView stackViews[32];
+	xStrView *views = stackViews;
+	if (count <= 0) {
+		xStrJoin(str, sep, NULL, 0);
 		return;
-	const int diff = len - str->len;
-	for (int i = 0; i < diff; i++)
-		xStrPrependCh(str, fill);
+	}
+	if (count > 32) {
+		if ((size_t)count > SIZE_MAX / sizeof(xStrView))
+			return;
+		views = strAlloc(str->alloc, count * sizeof(xStrView));
+		if (!views)
+			return;
+	}
+	for (xStrSize i = 0; i < count; i++)
+		views[i] = xStrViewOf(&parts[i]);
+	xStrJoin(str, sep, views, count);
+	if (views != stackViews)
+		strFree(str->alloc, views, count * sizeof(xStrView));
 }
 
-void xStrCenter(xStr *str, int len, char fill)
+// wyhash: 64x64->128 multiply-and-fold mixing over 16 or 48 byte strides,
+// with short keys read as overlapping words so there is no byte loop.
+static const uint64_t hashSecret[4] = {
+	0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+	0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 hashU128;
+
+static void hashMum(uint64_t *a, uint64_t *b)
 {
-	if (len <= str->len)
+	hashU128 r = (hashU128)*a * *b;
+	*a = (uint64_t)r;
+	*b = (uint64_t)(r >> 64);
+}
+#else
+static void hashMum(uint64_t *a, uint64_t *b)
+{
+	uint64_t ha = *a >> 32, hb = *b >> 32;
+	uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+}
+#endif
+
+static uint64_t hashMix(uint64_t a, uint64_t b)
+{
+	hashMum(&a, &b);
+	return a ^ b;
+}
+
+// Little-endian loads, so hashes are the same on every host.
+static uint64_t hashRead8(const unsigned char *p)
+{
+	return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16
+		| (uint64_t)p[3] << 24 | (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40
+		| (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static uint64_t hashRead4(const unsigned char *p)
+{
+	return (uint64_t)p[0] | (uint64_t)p[1] << 8 | (uint64_t)p[2] << 16
+		| (uint64_t)p[3] << 24;
+}
+
+uint64_t xStrHashLen(const char *s, xStrSize len, uint64_t seed)
+{
+	const unsigned char *p = (const unsigned char *)s;
+	const size_t n = (len > 0) ? (size_t)len : 0;
+	uint64_t a, b;
+
+	seed ^= hashMix(seed ^ hashSecret[0], hashSecret[1]);
+	if (n <= 16) {
+		if (n >= 4) {
+			const size_t mid = (n >> 3) << 2;
+			a = hashRead4(p) << 32 | hashRead4(p + mid);
+			b = hashRead4(p + n - 4) << 32 | hashRead4(p + n - 4 - mid);
+		} else if (n > 0) {
+			a = (uint64_t)p[0] << 16 | (uint64_t)p[n >> 1] << 8 | p[n - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = n;
+		if (i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = hashMix(hashRead8(p) ^ hashSecret[1],
+					hashRead8(p + 8) ^ seed);
+				see1 = hashMix(hashRead8(p + 16) ^ hashSecret[2],
+					hashRead8(p + 24) ^ see1);
+				see2 = hashMix(hashRead8(p + 32) ^ hashSecret[3],
+					hashRead8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = hashMix(hashRead8(p) ^ hashSecret[1], hashRead8(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = hashRead8(p + i - 16);
+		b = hashRead8(p + i - 8);
+	}
+	a ^= hashSecret[1];
+	b ^= seed;
+	hashMum(&a, &b);
+	return hashMix(a ^ hashSecret[0] ^ n, b ^ hashSecret[1]);
+}
+
+uint64_t xStrHash(const xStr *str)
+{
+	return xStrHashLen(str->str, str->len, 0);
+}
+
+uint64_t xStrViewHash(xStrView view)
+{
+	return xStrHashLen(view.str, view.len, 0);
+}
+
+// Entropy for the process-wide seed secret: the system's random device where
+// there is one, otherwise whatever varies between runs (clock, stack address
+// under ASLR).
+static uint64_t seedEntropy(void)
+{
+	uint64_t bits = 0;
+	FILE *f = fopen("/dev/urandom", "rb");
+	if (f) {
+		if (fread(&bits, sizeof(bits), 1, f) != 1)
+			bits = 0;
+		fclose(f);
+	}
+	if (!bits) {
+		const uint64_t mix[3] = { (uint64_t)time(NULL), (uint64_t)clock(),
+			(uint64_t)(uintptr_t)&bits };
+		bits = xStrHashLen((const char *)mix, sizeof(mix), 0);
+	}
+	return bits | 1;
+}
+
+uint64_t xStrHashSeed(void)
+{
+	static uint64_t secret, counter;
+#ifdef __GNUC__
+	uint64_t key = __atomic_load_n(&secret, __ATOMIC_ACQUIRE);
+	if (!key) {
+		uint64_t expected = 0;
+		key = seedEntropy();
+		if (!__atomic_compare_exchange_n(&secret, &expected, key, 0,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			key = expected;
+	}
+	const uint64_t n = __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED);
+#else
+	if (!secret)
+		secret = seedEntropy();
+	const uint64_t key = secret, n = counter++;
+#endif
+	return xStrHashLen((const char *)&n, sizeof(n), key);
+}
+
+// Appends n bytes written by the caller straight into reserved capacity;
+// returns where to write them, or NULL if str can't grow.
+static char *strAppendSpace(xStr *str, xStrSize n)
+{
+	if (n > XSTR_SIZE_MAX - 1 - str->len || !xStrEnsureCap(str, str->len + n + 1))
+		return NULL;
+	return str->str + str->len;
+}
+
+static void strAppendDone(xStr *str, xStrSize n)
+{
+	str->len += n;
+	str->str[str->len] = '\0';
+}
+
+static const char digitPairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static int decimalDigits(unsigned long long n)
+{
+	int d = 1;
+	for (;;) {
+		if (n < 10)
+			return d;
+		if (n < 100)
+			return d + 1;
+		if (n < 1000)
+			return d + 2;
+		if (n < 10000)
+			return d + 3;
+		n /= 10000;
+		d += 4;
+	}
+}
+
+// Writes n backwards, two digits at a time, ending just before end.
+static void writeDecimal(char *end, unsigned long long n)
+{
+	while (n >= 100) {
+		const unsigned i = (n % 100) * 2;
+		n /= 100;
+		*--end = digitPairs[i + 1];
+		*--end = digitPairs[i];
+	}
+	if (n >= 10) {
+		*--end = digitPairs[n * 2 + 1];
+		*--end = digitPairs[n * 2];
+	} else {
+		*--end = '0' + n;
+	}
+}
+
+static void strAppendDecimal(xStr *str, unsigned long long n, int negative)
+{
+	const int len = negative + decimalDigits(n);
+	char *p = strAppendSpace(str, len);
+	if (!p)
 		return;
+	if (negative)
+		*p = '-';
+	writeDecimal(p + len, n);
+	strAppendDone(str, len);
+}
 
-	xStr tmp;
-	xStrInit(&tmp, "");
-	xStrReserve(&tmp, len);
+void xStrAppendInt(xStr *str, long long n)
+{
+	if (n < 0)
+		strAppendDecimal(str, 0ull - (unsigned long long)n, 1);
+	else
+		strAppendDecimal(str, n, 0);
+}
+
+void xStrAppendUInt(xStr *str, unsigned long long n)
+{
+	strAppendDecimal(str, n, 0);
+}
 
-	const int x = (len / 2) - (str->len / 2);
-	for (int i = 0; i < x; i++)
-		xStrAppendCh(&tmp, fill);
-	for (int i = 0; i < str->len; i++)
-		xStrAppendCh(&tmp, str->str[i]);
-	for (int i = x + str->len; i < len; i++)
-		xStrAppendCh(&tmp, fill);
+void xStrAppendHex(xStr *str, unsigned long long n)
+{
+	int len = 1;
+	while (len < 16 && (n >> (len * 4)) != 0)
+		len++;
+	char *p = strAppendSpace(str, len);
+	if (!p)
+		return;
+	for (int i = len - 1; i >= 0; i--, n >>= 4)
+		p[i] = "0123456789abcdef"[n & 15];
+	strAppendDone(str, len);
+}
 
-	xStrSwap(&tmp, str);
-	xStrCleanup(&tmp);
+// Grisu3 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers"): the scaled boundaries of the double give the digits in
+// 64-bit integer arithmetic, along with a bound on the error. When the bound
+// proves the digits are the shortest that read back as the same double, and
+// the closest of those, they are used; the rest (about one double in 200)
+// go through the exact but slower shortestSlow().
+typedef struct {
+	uint64_t f;
+	int e;
+} DiyFp;
+
+#define DP_HIDDEN (1ull << 52)
+#define DP_SIGNIFICAND (DP_HIDDEN - 1)
+#define DOUBLE_MAX_CHARS 32
+
+// 10^k for k = -348, -340, ..., 340 as normalized 64-bit significands and
+// binary exponents.
+static const uint64_t cachedPowersF[87] = {
+	0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull,
+	0xcf42894a5dce35eaull, 0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull,
+	0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full, 0xbe5691ef416bd60cull,
+	0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+	0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull,
+	0xc21094364dfb5637ull, 0x9096ea6f3848984full, 0xd77485cb25823ac7ull,
+	0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull, 0xb23867fb2a35b28eull,
+	0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+	0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull,
+	0xb5b5ada8aaff80b8ull, 0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull,
+	0x964e858c91ba2655ull, 0xdff9772470297ebdull, 0xa6dfbd9fb8e5b88full,
+	0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+	0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull,
+	0xaa242499697392d3ull, 0xfd87b5f28300ca0eull, 0xbce5086492111aebull,
+	0x8cbccc096f5088ccull, 0xd1b71758e219652cull, 0x9c40000000000000ull,
+	0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+	0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull,
+	0x9f4f2726179a2245ull, 0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull,
+	0x83c7088e1aab65dbull, 0xc45d1df942711d9aull, 0x924d692ca61be758ull,
+	0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+	0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull,
+	0x952ab45cfa97a0b3ull, 0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull,
+	0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull, 0x88fcf317f22241e2ull,
+	0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+	0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull,
+	0x8bab8eefb6409c1aull, 0xd01fef10a657842cull, 0x9b10a4e5e9913129ull,
+	0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull, 0x80444b5e7aa7cf85ull,
+	0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+	0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull,
+};
+
+static const int16_t cachedPowersE[87] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+	-901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+	-582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+	-263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+	56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+	694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+	1013, 1039, 1066,
+};
+
+static const uint64_t pow10u64[20] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+	10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+	100000000000ull, 1000000000000ull, 10000000000000ull,
+	100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+	100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+static DiyFp diyFpMul(DiyFp x, DiyFp y)
+{
+	const uint64_t m32 = 0xffffffffull;
+	const uint64_t a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+	const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	uint64_t mid = (bd >> 32) + (ad & m32) + (bc & m32);
+	mid += 1ull << 31; // round
+	const DiyFp r = { ac + (ad >> 32) + (bc >> 32) + (mid >> 32), x.e + y.e + 64 };
+	return r;
 }
 
-int xStrStartsWith(const xStr *str, const char *s)
+static DiyFp diyFpNormalize(DiyFp x)
 {
-	if (!s || s[0] == '\0')
-		return 0;
-	const char *found = strstr(str->str, s);
-	if (!found)
-		return 0;
-	return (found == str->str);
+	while (!(x.f & (1ull << 63))) {
+		x.f <<= 1;
+		x.e--;
+	}
+	return x;
 }
 
-int xStrEndsWith(const xStr *str, const char *s)
+// Returns c_k = 10^-k with its binary exponent in [-60, -32] after scaling
+// something with binary exponent e.
+static DiyFp cachedPower(int e, int *k)
 {
-	if (!s || s[0] == '\0')
-		return 0;
-	int slen = strlen(s);
-	if (slen > str->len)
+	const double dk = (-61 - e) * 0.30102999566398114 + 347;
+	int ik = (int)dk;
+	if (dk - ik > 0.0)
+		ik++;
+	const unsigned index = (unsigned)((ik >> 3) + 1);
+	*k = -(-348 + (int)index * 8);
+	const DiyFp r = { cachedPowersF[index], cachedPowersE[index] };
+	return r;
+}
+
+// Moves the last digit down while that brings it closer to w, then checks
+// that the result is certainly the closest shortest one: every scaled value
+// is only known to within unit, so digits that might round the other way,
+// or sit too near the edge of the interval, fail.
+static int grisuRoundWeed(char *buf, int len, uint64_t distTooHighW,
+	uint64_t unsafeInterval, uint64_t rest, uint64_t tenKappa, uint64_t unit)
+{
+	const uint64_t smallDist = distTooHighW - unit;
+	const uint64_t bigDist = distTooHighW + unit;
+	while (rest < smallDist && unsafeInterval - rest >= tenKappa
+		&& (rest + tenKappa < smallDist
+			|| smallDist - rest >= rest + tenKappa - smallDist)) {
+		buf[len - 1]--;
+		rest += tenKappa;
+	}
+	if (rest < bigDist && unsafeInterval - rest >= tenKappa
+		&& (rest + tenKappa < bigDist || bigDist - rest > rest + tenKappa - bigDist))
 		return 0;
-	const char *last = str->str + (str->len - slen);
-	return (strcmp(last, s) == 0);
+	return 2 * unit <= rest && rest <= unsafeInterval - 4 * unit;
+}
+
+// Generates digits of the upper boundary until what is left fits in the
+// interval widened by the error of the scaling. Returns the number of digits,
+// negated when they can't be proven shortest.
+static int digitGen(DiyFp low, DiyFp w, DiyFp high, char *buf, int *k)
+{
+	const int shift = -w.e;
+	const uint64_t one = 1ull << shift;
+	uint64_t unit = 1;
+	const uint64_t tooHigh = high.f + unit;
+	uint64_t unsafeInterval = tooHigh - (low.f - unit);
+	uint32_t p1 = (uint32_t)(tooHigh >> shift);
+	uint64_t p2 = tooHigh & (one - 1);
+	int kappa = decimalDigits(p1);
+	int len = 0;
+
+	while (kappa > 0) {
+		const uint32_t div = (uint32_t)pow10u64[kappa - 1];
+		buf[len++] = '0' + p1 / div;
+		p1 %= div;
+		kappa--;
+		const uint64_t rest = ((uint64_t)p1 << shift) + p2;
+		if (rest < unsafeInterval) {
+			*k += kappa;
+			return grisuRoundWeed(buf, len, tooHigh - w.f, unsafeInterval, rest,
+				(uint64_t)div << shift, unit) ? len : -len;
+		}
+	}
+	for (;;) {
+		p2 *= 10;
+		unit *= 10;
+		unsafeInterval *= 10;
+		buf[len++] = '0' + (int)(p2 >> shift);
+		p2 &= one - 1;
+		kappa--;
+		if (p2 < unsafeInterval) {
+			*k += kappa;
+			return grisuRoundWeed(buf, len, (tooHigh - w.f) * unit, unsafeInterval,
+				p2, one, unit) ? len : -len;
+		}
+	}
+}
+
+// Writes the digits of a finite, positive d to buf and sets *k so that
+// d is digits * 10^k. Returns the number of digits, negated if Grisu3 can't
+// vouch for them.
+static int grisu3(double d, char *buf, int *k)
+{
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+	const int biased = (int)((bits >> 52) & 0x7ff);
+	DiyFp v = { bits & DP_SIGNIFICAND, -1074 };
+	if (biased) {
+		v.f |= DP_HIDDEN;
+		v.e = biased - 1075;
+	}
+
+	// the boundaries halfway to the neighbouring doubles, with m+ normalized
+	// and m- brought to the same exponent; below a power of two the lower
+	// neighbour is twice as close
+	DiyFp mp = { (v.f << 1) + 1, v.e - 1 };
+	while (!(mp.f & (DP_HIDDEN << 1))) {
+		mp.f <<= 1;
+		mp.e--;
+	}
+	mp.f <<= 64 - 52 - 2;
+	mp.e -= 64 - 52 - 2;
+	DiyFp mm = (v.f == DP_HIDDEN && biased > 1) ? (DiyFp){ (v.f << 2) - 1, v.e - 2 }
+		: (DiyFp){ (v.f << 1) - 1, v.e - 1 };
+	mm.f <<= mm.e - mp.e;
+	mm.e = mp.e;
+
+	const DiyFp c = cachedPower(mp.e, k);
+	return digitGen(diyFpMul(mm, c), diyFpMul(diyFpNormalize(v), c),
+		diyFpMul(mp, c), buf, k);
+}
+
+// Rounds d to prec significant digits with the C library's correctly
+// rounded conversion and sets *m and *e to the digits and exponent if they
+// read back as d. The nearest digits can fall just outside the rounding
+// interval when it is lopsided, so their neighbours are tried too.
+static int slowDigits(double d, int prec, uint64_t *m, int *e)
+{
+	char tmp[40];
+	snprintf(tmp, sizeof(tmp), "%.*e", prec - 1, d);
+	uint64_t digits = 0;
+	const char *p = tmp;
+	for (; *p != 'e'; p++) {
+		if (*p >= '0' && *p <= '9')
+			digits = digits * 10 + (*p - '0');
+	}
+	*e = atoi(p + 1) - (prec - 1);
+	const uint64_t candidates[3] = { digits, digits - 1, digits + 1 };
+	for (int i = 0; i < 3; i++) {
+		snprintf(tmp, sizeof(tmp), "%llue%d", (unsigned long long)candidates[i], *e);
+		if (strtod(tmp, NULL) == d) {
+			*m = candidates[i];
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// The exact path for the doubles Grisu3 gives up on, given the length it
+// guessed, which is nearly always right or one short. A precision that reads
+// back means every longer one does too, so the answer is found by walking
+// from the guess.
+static int shortestSlow(double d, char *buf, int *k, int guess)
+{
+	uint64_t m, shorter;
+	int prec = (guess < 17) ? guess : 17, e;
+	if (slowDigits(d, prec, &m, k)) {
+		while (prec > 1 && slowDigits(d, prec - 1, &shorter, &e)) {
+			prec--;
+			m = shorter;
+			*k = e;
+		}
+	} else {
+		while (!slowDigits(d, ++prec, &m, k))
+			;
+	}
+	int len = snprintf(buf, DOUBLE_MAX_CHARS, "%llu", (unsigned long long)m);
+	while (len > 1 && buf[len - 1] == '0') {
+		len--;
+		(*k)++;
+	}
+	return len;
+}
+
+static int writeExponent(char *p, int e)
+{
+	char *start = p;
+	*p++ = 'e';
+	*p++ = (e < 0) ? '-' : '+';
+	if (e < 0)
+		e = -e;
+	if (e >= 100) {
+		*p++ = '0' + e / 100;
+		e %= 100;
+		*p++ = digitPairs[e * 2];
+		*p++ = digitPairs[e * 2 + 1];
+	} else if (e >= 10) {
+		*p++ = digitPairs[e * 2];
+		*p++ = digitPairs[e * 2 + 1];
+	} else {
+		*p++ = '0' + e;
+	}
+	return p - start;
+}
+
+// Lays out len digits times 10^k the way JavaScript prints numbers: plain
+// notation from 1e-6 up to 1e21, scientific outside that.
+static int formatDigits(char *buf, int len, int k)
+{
+	const int kk = len + k; // 10^(kk - 1) <= value < 10^kk
+	if (k >= 0 && kk <= 21) {
+		memset(buf + len, '0', k);
+		return kk;
+	}
+	if (kk > 0 && kk <= 21) {
+		memmove(buf + kk + 1, buf + kk, len - kk);
+		buf[kk] = '.';
+		return len + 1;
+	}
+	if (kk > -6 && kk <= 0) {
+		const int offset = 2 - kk;
+		memmove(buf + offset, buf, len);
+		buf[0] = '0';
+		buf[1] = '.';
+		memset(buf + 2, '0', offset - 2);
+		return len + offset;
+	}
+	if (len == 1)
+		return 1 + writeExponent(buf + 1, kk - 1);
+	memmove(buf + 2, buf + 1, len - 1);
+	buf[1] = '.';
+	return len + 1 + writeExponent(buf + len + 1, kk - 1);
+}
+
+void xStrAppendDouble(xStr *str, double d)
+{
+	if (d != d) {
+		xStrAppendLen(str, "nan", 3);
+		return;
+	}
+	char *p = strAppendSpace(str, DOUBLE_MAX_CHARS);
+	if (!p)
+		return;
+	char *w = p;
+	if (signbit(d)) {
+		*w++ = '-';
+		d = -d;
+	}
+	if (d == 0.0) {
+		*w++ = '0';
+	} else if (isinf(d)) {
+		memcpy(w, "inf", 3);
+		w += 3;
+	} else {
+		int k;
+		int len = grisu3(d, w, &k);
+		if (len < 0)
+			len = shortestSlow(d, w, &k, -len);
+		w += formatDigits(w, len, k);
+	}
+	strAppendDone(str, w - p);
 }
@@ -1,67 +1,236 @@
 #ifndef XSTR_H
 #define XSTR_H
 
+#include <limits.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __GNUC__
 #define XSTR_PRINTF(nFmt, nVa) __attribute__((format(printf, nFmt, nVa)))
 #define XSTR_WARN_UNUSED_RESULT __attribute__((warn_unused_result))
+#define XSTR_SENTINEL __attribute__((sentinel))
 #else
 #define XSTR_PRINTF(nFmt, nVa)
 #define XSTR_WARN_UNUSED_RESULT
+#define XSTR_SENTINEL
 #endif
 
 typedef struct {
-	int len, cap;
+	void *(*alloc)(void *ctx, size_t size);
+	void *(*realloc)(void *ctx, void *ptr, size_t oldSize, size_t newSize);
+	void (*free)(void *ctx, void *ptr, size_t size);
+	void *ctx;
+} xStrAllocator;
+
+typedef struct xStrArenaBlock xStrArenaBlock;
+
+// Bump-pointer allocator; everything allocated from it is released at once
+// by xStrArenaReset() or xStrArenaCleanup(). Strings using the arena must
+// not be used after a reset until they are initialized again. Blocks come
+// from the allocator passed to xStrArenaInitAlloc(), or the default one.
+// The allocator returned by xStrArenaAllocator() points back at the arena,
+// so the arena must not move while strings use it.
+typedef struct {
+	xStrAllocator allocator;
+	const xStrAllocator *backing;
+	xStrArenaBlock *first, *cur;
+	size_t blockSize;
+	char *last;
+} xStrArena;
+
+// Lengths, positions and capacities are int by default; build with
+// XSTR_64BIT defined to use ptrdiff_t for strings larger than 2 GiB.
+#ifdef XSTR_64BIT
+typedef ptrdiff_t xStrSize;
+#define XSTR_SIZE_MAX PTRDIFF_MAX
+#else
+typedef int xStrSize;
+#define XSTR_SIZE_MAX INT_MAX
+#endif
+
+#define XSTR_INLINE_CAP 24
+
+typedef struct xStrShared xStrShared;
+
+// Called when the last string referring to an external buffer lets go.
+typedef void (*xStrReleaseFunc)(void *ctx, const char *data, xStrSize len);
+
+// Strings that fit in XSTR_INLINE_CAP bytes (including the terminator) are
+// kept in buf with str pointing at it. An xStr therefore must not be copied
+// or moved bytewise: not by assignment (xStr b = a;), memcpy(), realloc() of
+// an array of them or qsort(), all of which leave str pointing at the old
+// location. Use xStrCopy() or xStrSwap() instead, and keep xStr * in
+// containers whose elements move. buf makes every xStr 48 bytes (56 with
+// XSTR_64BIT), including heap strings, which don't use it.
+// A cap of 0 means the buffer is read-only, shared with other strings or
+// owned by someone else, and is copied before the first change.
+typedef struct {
+	xStrSize len, cap;
 	char *str;
+	const xStrAllocator *alloc;
+	char buf[XSTR_INLINE_CAP];
 } xStr;
 
+// A non-owning, not necessarily NUL-terminated reference to len bytes.
+typedef struct {
+	const char *str;
+	xStrSize len;
+} xStrView;
+
+typedef struct {
+	xStrView rest, delim;
+	unsigned char set[32];
+	char ch;
+	int mode, done;
+} xStrSplitIter;
+
+typedef enum {
+	XSTR_GROW_DOUBLE,
+	XSTR_GROW_HALF,
+	XSTR_GROW_FIXED,
+	XSTR_GROW_EXACT
+} xStrGrowKind;
+
+// How capacity grows when a string runs out of room: doubling, by half,
+// by a fixed increment or to exactly what is needed. With roundUp set,
+// blocks from the malloc allocator are used up to their real usable size.
+// A shrinkFactor of 2 or more gives memory back when an edit leaves cap
+// above shrinkFactor times what the string needs, shrinking to half of
+// that so a little regrowth doesn't reallocate again.
+typedef struct {
+	xStrGrowKind kind;
+	xStrSize increment;
+	int roundUp;
+	int shrinkFactor;
+} xStrGrowth;
+
+// Call sites that allocation and copy counts are charged to. A function
+// that calls other xStr functions is charged for all of their work.
+typedef enum {
+	XSTR_SITE_OTHER,
+	XSTR_SITE_INIT,
+	XSTR_SITE_ASSIGN,
+	XSTR_SITE_INSERT,
+	XSTR_SITE_FORMAT,
+	XSTR_SITE_ERASE,
+	XSTR_SITE_OVERWRITE,
+	XSTR_SITE_REPLACE,
+	XSTR_SITE_RESERVE,
+	XSTR_SITE_COMPACT,
+	XSTR_SITE_PAD,
+	XSTR_SITE_JOIN,
+	XSTR_SITE_COUNT
+} xStrStatSite;
+
+typedef struct {
+	unsigned long long allocs, reallocs, frees;
+	unsigned long long bytesAllocated, bytesCopied, bytesSlack;
+} xStrStatCounters;
+
+// Counters are per thread and only kept when the library is built with
+// XSTR_STATS defined; otherwise snapshots are all zero.
+typedef struct {
+	xStrStatCounters total;
+	xStrStatCounters site[XSTR_SITE_COUNT];
+} xStrStats;
+
+void xStrSetDefaultAllocator(const xStrAllocator *alloc);
+const xStrAllocator *xStrGetDefaultAllocator(void);
+void xStrSetDefaultGrowth(const xStrGrowth *growth);
+const xStrGrowth *xStrGetDefaultGrowth(void);
+
+void xStrStatsSnapshot(xStrStats *stats);
+void xStrStatsReset(void);
+const char *xStrStatSiteName(xStrStatSite site);
+
+void xStrArenaInit(xStrArena *arena, size_t blockSize);
+void xStrArenaInitAlloc(xStrArena *arena, size_t blockSize, const xStrAllocator *alloc);
+void xStrArenaCleanup(xStrArena *arena);
+void xStrArenaReset(xStrArena *arena);
+void *xStrArenaAlloc(xStrArena *arena, size_t size);
+const xStrAllocator *xStrArenaAllocator(xStrArena *arena);
+
 void xStrInit(xStr *str, const char *init);
-void xStrInitLen(xStr *str, const char *init, int len);
+void xStrInitLen(xStr *str, const char *init, xStrSize len);
+void xStrInitAlloc(xStr *str, const char *init, const xStrAllocator *alloc);
+void xStrInitLenAlloc(xStr *str, const char *init, xStrSize len, const xStrAllocator *alloc);
+void xStrSetAllocator(xStr *str, const xStrAllocator *alloc);
 void xStrCleanup(xStr *str);
+
+// Copies share src's heap buffer instead of duplicating it, which means
+// setting up src's reference count on the first copy. Reference counts are
+// atomic, so copies may be handed to other threads, but one xStr must still
+// not be used from two threads at once.
+void xStrInitCopy(xStr *str, xStr *src);
+void xStrCopy(xStr *str, xStr *src);
+int xStrIsShared(const xStr *str);
+
+// Wraps len bytes at data, which must be followed by a NUL and stay valid
+// until release is called, without copying them. The string copies them
+// before the first change.
+void xStrInitExternal(xStr *str, const char *data, xStrSize len,
+	xStrReleaseFunc release, void *ctx);
+
 xStr *xStrNew(const char *init) XSTR_WARN_UNUSED_RESULT;
-xStr *xStrNewLen(const char *init, int len) XSTR_WARN_UNUSED_RESULT;
+xStr *xStrNewLen(const char *init, xStrSize len) XSTR_WARN_UNUSED_RESULT;
 void xStrDelete(xStr *str);
 
 void xStrClear(xStr *str);
 void xStrCompact(xStr *str);
-void xStrReserve(xStr *str, int n);
-void xStrResize(xStr *str, int len);
+void xStrReserve(xStr *str, xStrSize n);
+void xStrResize(xStr *str, xStrSize len);
 void xStrSwap(xStr *str, xStr *other);
 
 void xStrAssign(xStr *str, const char *s);
-void xStrAssignLen(xStr *str, const char *s, int len);
+void xStrAssignLen(xStr *str, const char *s, xStrSize len);
 void xStrAssignCh(xStr *str, char ch);
 void xStrAssignFmt(xStr *str, const char *fmt, ...) XSTR_PRINTF(2, 3);
 void xStrAssignFmtV(xStr *str, const char *fmt, va_list ap);
 
-void xStrInsert(xStr *str, int pos, const char *s);
-void xStrInsertLen(xStr *str, int pos, const char *s, int len);
-void xStrInsertCh(xStr *str, int pos, char ch);
-void xStrInsertFmt(xStr *str, int pos, const char *fmt, ...) XSTR_PRINTF(3, 4);
-void xStrInsertFmtV(xStr *str, int pos, const char *fmt, va_list ap);
+void xStrInsert(xStr *str, xStrSize pos, const char *s);
+void xStrInsertLen(xStr *str, xStrSize pos, const char *s, xStrSize len);
+void xStrInsertCh(xStr *str, xStrSize pos, char ch);
+void xStrInsertFmt(xStr *str, xStrSize pos, const char *fmt, ...) XSTR_PRINTF(3, 4);
+void xStrInsertFmtV(xStr *str, xStrSize pos, const char *fmt, va_list ap);
 
 void xStrPrepend(xStr *str, const char *s);
-void xStrPrependLen(xStr *str, const char *s, int len);
+void xStrPrependLen(xStr *str, const char *s, xStrSize len);
 void xStrPrependCh(xStr *str, char ch);
 void xStrPrependFmt(xStr *str, const char *fmt, ...) XSTR_PRINTF(2, 3);
 void xStrPrependFmtV(xStr *str, const char *fmt, va_list ap);
 
 void xStrAppend(xStr *str, const char *s);
-void xStrAppendLen(xStr *str, const char *s, int len);
+void xStrAppendLen(xStr *str, const char *s, xStrSize len);
 void xStrAppendCh(xStr *str, char ch);
 void xStrAppendFmt(xStr *str, const char *fmt, ...) XSTR_PRINTF(2, 3);
 void xStrAppendFmtV(xStr *str, const char *fmt, va_list ap);
 
-void xStrErase(xStr *str, int pos, int len);
+// Append or assign a NULL-terminated list of strings, growing str once.
+void xStrAppendMany(xStr *str, ...) XSTR_SENTINEL;
+void xStrAppendManyV(xStr *str, va_list ap);
+void xStrConcat(xStr *str, ...) XSTR_SENTINEL;
+void xStrAppendViews(xStr *str, const xStrView *parts, xStrSize count);
+
+// Integers are written without going through printf. Doubles come out as
+// the fewest significant digits that read back as the same value, laid out
+// the way JavaScript prints numbers ("0.1", "1e+21") except that negative
+// zero keeps its sign ("-0"), or as "nan" or "inf".
+void xStrAppendInt(xStr *str, long long n);
+void xStrAppendUInt(xStr *str, unsigned long long n);
+void xStrAppendHex(xStr *str, unsigned long long n);
+void xStrAppendDouble(xStr *str, double d);
 
-void xStrOverwrite(xStr *str, int pos, int len, const char *s);
-void xStrOverwriteLen(xStr *str, int pos, int len, const char *s, int slen);
-void xStrOverwriteCh(xStr *str, int pos, int len, char ch);
-void xStrOverwriteFmt(xStr *str, int pos, int len, const char *fmt, ...) XSTR_PRINTF(4, 5);
-void xStrOverwriteFmtV(xStr *str, int pos, int len, const char *fmt, va_list ap);
+void xStrErase(xStr *str, xStrSize pos, xStrSize len);
 
-void xStrReplace(xStr *str, const char *needle, const char *repl, int maxReplace);
+void xStrOverwrite(xStr *str, xStrSize pos, xStrSize len, const char *s);
+void xStrOverwriteLen(xStr *str, xStrSize pos, xStrSize len, const char *s, xStrSize slen);
+void xStrOverwriteCh(xStr *str, xStrSize pos, xStrSize len, char ch);
+void xStrOverwriteFmt(xStr *str, xStrSize pos, xStrSize len, const char *fmt, ...) XSTR_PRINTF(4, 5);
+void xStrOverwriteFmtV(xStr *str, xStrSize pos, xStrSize len, const char *fmt, va_list ap);
+
+void xStrReplace(xStr *str, const char *needle, const char *repl, xStrSize maxReplace);
+void xStrReplaceLen(xStr *str, const char *needle, xStrSize needleLen, const char *repl, xStrSize replLen, xStrSize maxReplace);
 
 void xStrStripFront(xStr *str, const char *chrs);
 void xStrStripBack(xStr *str, const char *chrs);
@@ -69,21 +238,70 @@ void xStrStrip(xStr *str, const char *chrs);
 
 int xStrCompare(const xStr *str1, const xStr *str2);
 int xStrCaseCompare(const xStr *str1, const xStr *str2);
+int xStrCaseCompareLocale(const xStr *str1, const xStr *str2);
 int xStrEqual(const xStr *str1, const xStr *str2);
 
 void xStrToUpper(xStr *str);
 void xStrToLower(xStr *str);
+void xStrToUpperLocale(xStr *str);
+void xStrToLowerLocale(xStr *str);
 
-int xStrFirstIndexOf(const xStr *str, const char *s);
-int xStrFirstIndexOfCh(const xStr *str, char c);
-int xStrLastIndexOf(const xStr *str, const char *s);
-int xStrLastIndexOfCh(const xStr *str, char c);
+xStrSize xStrFirstIndexOf(const xStr *str, const char *s);
+xStrSize xStrFirstIndexOfLen(const xStr *str, const char *s, xStrSize len);
+xStrSize xStrFirstIndexOfCh(const xStr *str, char c);
+xStrSize xStrLastIndexOf(const xStr *str, const char *s);
+xStrSize xStrLastIndexOfLen(const xStr *str, const char *s, xStrSize len);
+xStrSize xStrLastIndexOfCh(const xStr *str, char c);
 
-void xStrLeftJustify(xStr *str, int len, char fill);
-void xStrRightJustify(xStr *str, int len, char fill);
-void xStrCenter(xStr *str, int len, char fill);
+void xStrLeftJustify(xStr *str, xStrSize len, char fill);
+void xStrRightJustify(xStr *str, xStrSize len, char fill);
+void xStrCenter(xStr *str, xStrSize len, char fill);
 
 int xStrStartsWith(const xStr *str, const char *s);
+int xStrStartsWithLen(const xStr *str, const char *s, xStrSize len);
 int xStrEndsWith(const xStr *str, const char *s);
+int xStrEndsWithLen(const xStr *str, const char *s, xStrSize len);
+
+xStrView xStrViewMake(const char *s, xStrSize len);
+xStrView xStrViewOf(const xStr *str);
+xStrView xStrSlice(const xStr *str, xStrSize pos, xStrSize len);
+xStrView xStrViewSlice(xStrView view, xStrSize pos, xStrSize len);
+
+xStrSize xStrViewFirstIndexOf(xStrView view, xStrView s);
+xStrSize xStrViewFirstIndexOfCh(xStrView view, char c);
+xStrSize xStrViewLastIndexOf(xStrView view, xStrView s);
+xStrSize xStrViewLastIndexOfCh(xStrView view, char c);
+
+int xStrViewCompare(xStrView view1, xStrView view2);
+int xStrViewCaseCompare(xStrView view1, xStrView view2);
+int xStrViewEqual(xStrView view1, xStrView view2);
+int xStrViewStartsWith(xStrView view, xStrView s);
+int xStrViewEndsWith(xStrView view, xStrView s);
+
+xStrView xStrViewStripFront(xStrView view, const char *chrs);
+xStrView xStrViewStripBack(xStrView view, const char *chrs);
+xStrView xStrViewStrip(xStrView view, const char *chrs);
+
+void xStrInitView(xStr *str, xStrView view);
+void xStrAssignView(xStr *str, xStrView view);
+void xStrInsertView(xStr *str, xStrSize pos, xStrView view);
+void xStrAppendView(xStr *str, xStrView view);
+
+void xStrSplitInitCh(xStrSplitIter *it, xStrView src, char delim);
+void xStrSplitInitStr(xStrSplitIter *it, xStrView src, xStrView delim);
+void xStrSplitInitAny(xStrSplitIter *it, xStrView src, const char *chrs);
+int xStrSplitNext(xStrSplitIter *it, xStrView *field);
+
+void xStrJoin(xStr *str, xStrView sep, const xStrView *parts, xStrSize count);
+void xStrJoinStrs(xStr *str, xStrView sep, const xStr *parts, xStrSize count);
+
+uint64_t xStrHashLen(const char *s, xStrSize len, uint64_t seed);
+uint64_t xStrHash(const xStr *str);
+uint64_t xStrViewHash(xStrView view);
+
+// Returns a fresh seed for xStrHashLen() from a secret drawn once per
+// process, so tables keyed by untrusted input can't be flooded with
+// colliding keys chosen in advance.
+uint64_t xStrHashSeed(void);
 
 #endif // XSTR_H
@@ -0,0 +1,138 @@
+#include "xstrgap.h"
+#include <string.h>
+
+#define GAP_MIN 64
+#define GAP_LEN(g) ((g)->cap - (g)->gapEnd + (g)->gapStart)
+
+static int gapEnsure(xStrGap *gap, xStrSize need)
+{
+	if (gap->gapEnd - gap->gapStart >= need)
+		return 1;
+	const xStrSize len = GAP_LEN(gap);
+	if (need > XSTR_SIZE_MAX - GAP_MIN - len)
+		return 0;
+	xStrSize ncap = (gap->cap > XSTR_SIZE_MAX / 2) ? XSTR_SIZE_MAX : gap->cap * 2;
+	if (ncap < len + need + GAP_MIN)
+		ncap = len + need + GAP_MIN;
+	char *tmp = gap->alloc->realloc(gap->alloc->ctx, gap->buf, gap->cap, ncap);
+	if (!tmp)
+		return 0;
+	const xStrSize tail = gap->cap - gap->gapEnd;
+	memmove(tmp + ncap - tail, tmp + gap->gapEnd, tail);
+	gap->buf = tmp;
+	gap->gapEnd = ncap - tail;
+	gap->cap = ncap;
+	return 1;
+}
+
+void xStrGapInit(xStrGap *gap, const char *init)
+{
+	xStrGapInitLen(gap, init, -1);
+}
+
+void xStrGapInitLen(xStrGap *gap, const char *init, xStrSize len)
+{
+	xStrGapInitAlloc(gap, NULL);
+	if (init)
+		xStrGapInsertLen(gap, 0, init, len);
+}
+
+void xStrGapInitStr(xStrGap *gap, const xStr *str)
+{
+	xStrGapInitLen(gap, str->str, str->len);
+}
+
+void xStrGapInitAlloc(xStrGap *gap, const xStrAllocator *alloc)
+{
+	gap->buf = NULL;
+	gap->cap = gap->gapStart = gap->gapEnd = 0;
+	gap->alloc = alloc ? alloc : xStrGetDefaultAllocator();
+}
+
+void xStrGapCleanup(xStrGap *gap)
+{
+	if (gap && gap->buf)
+		gap->alloc->free(gap->alloc->ctx, gap->buf, gap->cap);
+}
+
+xStrSize xStrGapLength(const xStrGap *gap)
+{
+	return GAP_LEN(gap);
+}
+
+xStrSize xStrGapCursor(const xStrGap *gap)
+{
+	return gap->gapStart;
+}
+
+void xStrGapMoveTo(xStrGap *gap, xStrSize pos)
+{
+	if (pos < 0 || pos > GAP_LEN(gap))
+		return;
+	if (pos < gap->gapStart) {
+		const xStrSize n = gap->gapStart - pos;
+		memmove(gap->buf + gap->gapEnd - n, gap->buf + pos, n);
+		gap->gapStart -= n;
+		gap->gapEnd -= n;
+	} else if (pos > gap->gapStart) {
+		const xStrSize n = pos - gap->gapStart;
+		memmove(gap->buf + gap->gapStart, gap->buf + gap->gapEnd, n);
+		gap->gapStart += n;
+		gap->gapEnd += n;
+	}
+}
+
+char xStrGapCharAt(const xStrGap *gap, xStrSize pos)
+{
+	if (pos < 0 || pos >= GAP_LEN(gap))
+		return '\0';
+	if (pos < gap->gapStart)
+		return gap->buf[pos];
+	return gap->buf[gap->gapEnd + (pos - gap->gapStart)];
+}
+
+void xStrGapInsert(xStrGap *gap, xStrSize pos, const char *s)
+{
+	xStrGapInsertLen(gap, pos, s, -1);
+}
+
+void xStrGapInsertLen(xStrGap *gap, xStrSize pos, const char *s, xStrSize len)
+{
+	if (!s || pos < 0 || pos > GAP_LEN(gap))
+		return;
+	if (len < 0) {
+		size_t slen = strlen(s);
+		if (slen > (size_t)XSTR_SIZE_MAX)
+			return;
+		len = slen;
+	}
+	if (len == 0 || !gapEnsure(gap, len))
+		return;
+	xStrGapMoveTo(gap, pos);
+	memcpy(gap->buf + gap->gapStart, s, len);
+	gap->gapStart += len;
+}
+
+void xStrGapInsertCh(xStrGap *gap, xStrSize pos, char ch)
+{
+	xStrGapInsertLen(gap, pos, &ch, 1);
+}
+
+void xStrGapErase(xStrGap *gap, xStrSize pos, xStrSize len)
+{
+	const xStrSize total = GAP_LEN(gap);
+	if (pos < 0 || pos >= total || len == 0 || len < -1)
+		return;
+	if (len == -1 || len > total - pos)
+		len = total - pos;
+	xStrGapMoveTo(gap, pos);
+	gap->gapEnd += len;
+}
+
+void xStrGapToStr(const xStrGap *gap, xStr *str)
+{
+	xStrClear(str);
+	xStrReserve(str, GAP_LEN(gap));
+	xStrAppendLen(str, gap->buf, gap->gapStart);
+	xStrAppendLen(str, gap->buf + gap->gapEnd, gap->cap - gap->gapEnd);
+}
@@ -0,0 +1,32 @@
+#ifndef XSTRGAP_H
+#define XSTRGAP_H
+
+#include "xstr.h"
+
+// Editing buffer with a movable gap left where the last edit happened, so
+// inserts and erases near the previous one only move the bytes in between.
+typedef struct {
+	char *buf;
+	xStrSize cap, gapStart, gapEnd;
+	const xStrAllocator *alloc;
+} xStrGap;
+
+void xStrGapInit(xStrGap *gap, const char *init);
+void xStrGapInitLen(xStrGap *gap, const char *init, xStrSize len);
+void xStrGapInitStr(xStrGap *gap, const xStr *str);
+void xStrGapInitAlloc(xStrGap *gap, const xStrAllocator *alloc);
+void xStrGapCleanup(xStrGap *gap);
+
+xStrSize xStrGapLength(const xStrGap *gap);
+xStrSize xStrGapCursor(const xStrGap *gap);
+void xStrGapMoveTo(xStrGap *gap, xStrSize pos);
+char xStrGapCharAt(const xStrGap *gap, xStrSize pos);
+
+void xStrGapInsert(xStrGap *gap, xStrSize pos, const char *s);
+void xStrGapInsertLen(xStrGap *gap, xStrSize pos, const char *s, xStrSize len);
+void xStrGapInsertCh(xStrGap *gap, xStrSize pos, char ch);
+void xStrGapErase(xStrGap *gap, xStrSize pos, xStrSize len);
+
+void xStrGapToStr(const xStrGap *gap, xStr *str);
+
+#endif // XSTRGAP_H
@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+#include "xstrintern.h"
+#include <pthread.h>
+#include <string.h>
+
+#define POOL_MIN_CAP 64
+#define POOL_BLOCK 16384
+
+// The hash is kept next to the handle so probing rarely leaves the table.
+struct xStrPoolSlot {
+	uint64_t hash;
+	xStrInterned *s;
+};
+
+static xStrInterned *poolFind(const xStrPool *pool, uint64_t hash, xStrView s)
+{
+	if (!pool->slots)
+		return NULL;
+	const xStrSize mask = pool->cap - 1;
+	for (xStrSize i = hash & mask;; i = (i + 1) & mask) {
+		const xStrPoolSlot *slot = &pool->slots[i];
+		if (!slot->s)
+			return NULL;
+		if (slot->hash == hash && slot->s->len == s.len
+			&& (s.len == 0 || memcmp(slot->s->str, s.str, s.len) == 0))
+			return slot->s;
+	}
+}
+
+static int poolGrow(xStrPool *pool)
+{
+	const xStrSize ncap = pool->cap ? pool->cap * 2 : POOL_MIN_CAP;
+	if (pool->cap > XSTR_SIZE_MAX / 2 || (size_t)ncap > SIZE_MAX / sizeof(xStrPoolSlot))
+		return 0;
+	xStrPoolSlot *slots = pool->alloc->alloc(pool->alloc->ctx, ncap * sizeof(xStrPoolSlot));
+	if (!slots)
+		return 0;
+	memset(slots, 0, ncap * sizeof(xStrPoolSlot));
+	const xStrSize mask = ncap - 1;
+	for (xStrSize i = 0; i < pool->cap; i++) {
+		if (!pool->slots[i].s)
+			continue;
+		xStrSize j = pool->slots[i].hash & mask;
+		while (slots[j].s)
+			j = (j + 1) & mask;
+		slots[j] = pool->slots[i];
+	}
+	if (pool->slots)
+		pool->alloc->free(pool->alloc->ctx, pool->slots, pool->cap * sizeof(xStrPoolSlot));
+	pool->slots = slots;
+	pool->cap = ncap;
+	return 1;
+}
+
+static xStrInterned *poolInsert(xStrPool *pool, uint64_t hash, xStrView s)
+{
+	if (pool->count >= pool->cap - pool->cap / 4 && !poolGrow(pool))
+		return NULL;
+	xStrInterned *h = xStrArenaAlloc(&pool->arena, sizeof(xStrInterned) + s.len + 1);
+	if (!h)
+		return NULL;
+	h->hash = hash;
+	h->len = s.len;
+	memcpy(h->str, s.str, s.len);
+	h->str[s.len] = '\0';
+
+	const xStrSize mask = pool->cap - 1;
+	xStrSize i = hash & mask;
+	while (pool->slots[i].s)
+		i = (i + 1) & mask;
+	pool->slots[i].hash = hash;
+	pool->slots[i].s = h;
+	pool->count++;
+	return h;
+}
+
+void xStrPoolInit(xStrPool *pool)
+{
+	xStrPoolInitAlloc(pool, NULL);
+}
+
+void xStrPoolInitAlloc(xStrPool *pool, const xStrAllocator *alloc)
+{
+	pool->slots = NULL;
+	pool->cap = pool->count = 0;
+	pool->alloc = alloc ? alloc : xStrGetDefaultAllocator();
+	pool->lock = NULL;
+	pool->seed = xStrHashSeed();
+	xStrArenaInitAlloc(&pool->arena, POOL_BLOCK, pool->alloc);
+}
+
+// Lookups of strings already in the pool only take the read side of the
+// lock; adding one takes the write side and checks again.
+int xStrPoolInitShared(xStrPool *pool)
+{
+	xStrPoolInit(pool);
+	pthread_rwlock_t *lock = pool->alloc->alloc(pool->alloc->ctx, sizeof(pthread_rwlock_t));
+	if (!lock)
+		return 0;
+	if (pthread_rwlock_init(lock, NULL) != 0) {
+		pool->alloc->free(pool->alloc->ctx, lock, sizeof(pthread_rwlock_t));
+		return 0;
+	}
+	pool->lock = lock;
+	return 1;
+}
+
+void xStrPoolCleanup(xStrPool *pool)
+{
+	if (!pool)
+		return;
+	if (pool->slots)
+		pool->alloc->free(pool->alloc->ctx, pool->slots, pool->cap * sizeof(xStrPoolSlot));
+	if (pool->lock) {
+		pthread_rwlock_destroy(pool->lock);
+		pool->alloc->free(pool->alloc->ctx, pool->lock, sizeof(pthread_rwlock_t));
+	}
+	pool->slots = NULL;
+	pool->lock = NULL;
+	pool->cap = pool->count = 0;
+	xStrArenaCleanup(&pool->arena);
+}
+
+xStrSize xStrPoolCount(xStrPool *pool)
+{
+	if (pool->lock)
+		pthread_rwlock_rdlock(pool->lock);
+	const xStrSize count = pool->count;
+	if (pool->lock)
+		pthread_rwlock_unlock(pool->lock);
+	return count;
+}
+
+const xStrInterned *xStrIntern(xStrPool *pool, xStrView s)
+{
+	if (s.len < 0 || (!s.str && s.len > 0))
+		return NULL;
+	const uint64_t hash = xStrHashLen(s.str, s.len, pool->seed);
+	xStrInterned *h;
+	if (!pool->lock) {
+		h = poolFind(pool, hash, s);
+		return h ? h : poolInsert(pool, hash, s);
+	}
+
+	pthread_rwlock_rdlock(pool->lock);
+	h = poolFind(pool, hash, s);
+	pthread_rwlock_unlock(pool->lock);
+	if (h)
+		return h;
+	pthread_rwlock_wrlock(pool->lock);
+	h = poolFind(pool, hash, s);
+	if (!h)
+		h = poolInsert(pool, hash, s);
+	pthread_rwlock_unlock(pool->lock);
+	return h;
+}
+
+const xStrInterned *xStrInternStr(xStrPool *pool, const xStr *str)
+{
+	return xStrIntern(pool, xStrViewOf(str));
+}
+
+const xStrInterned *xStrPoolLookup(xStrPool *pool, xStrView s)
+{
+	if (s.len < 0 || (!s.str && s.len > 0))
+		return NULL;
+	const uint64_t hash = xStrHashLen(s.str, s.len, pool->seed);
+	if (pool->lock)
+		pthread_rwlock_rdlock(pool->lock);
+	const xStrInterned *h = poolFind(pool, hash, s);
+	if (pool->lock)
+		pthread_rwlock_unlock(pool->lock);
+	return h;
+}
+
+xStrView xStrInternedView(const xStrInterned *s)
+{
+	xStrView view = { s->str, s->len };
+	return view;
+}
@@ -0,0 +1,41 @@
+#ifndef XSTRINTERN_H
+#define XSTRINTERN_H
+
+#include "xstr.h"
+
+// A pooled string. Each distinct byte string has exactly one handle per
+// pool, so two handles from the same pool are equal only if they are the
+// same pointer. Handles stay valid until the pool is cleaned up. The hash
+// uses the pool's own random seed, so it only means something within it.
+// All memory comes from the pool's allocator and nothing points back into
+// the xStrPool, so it may be moved between calls.
+typedef struct {
+	uint64_t hash;
+	xStrSize len;
+	char str[];
+} xStrInterned;
+
+typedef struct xStrPoolSlot xStrPoolSlot;
+
+typedef struct {
+	xStrPoolSlot *slots;
+	xStrSize cap, count;
+	const xStrAllocator *alloc;
+	xStrArena arena;
+	void *lock;
+	uint64_t seed;
+} xStrPool;
+
+void xStrPoolInit(xStrPool *pool);
+void xStrPoolInitAlloc(xStrPool *pool, const xStrAllocator *alloc);
+int xStrPoolInitShared(xStrPool *pool) XSTR_WARN_UNUSED_RESULT;
+void xStrPoolCleanup(xStrPool *pool);
+xStrSize xStrPoolCount(xStrPool *pool);
+
+const xStrInterned *xStrIntern(xStrPool *pool, xStrView s);
+const xStrInterned *xStrInternStr(xStrPool *pool, const xStr *str);
+const xStrInterned *xStrPoolLookup(xStrPool *pool, xStrView s);
+
+xStrView xStrInternedView(const xStrInterned *s);
+
+#endif // XSTRINTERN_H
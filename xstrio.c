@@ -0,0 +1,552 @@
+#define _DEFAULT_SOURCE
+#include "xstrio.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define READ_CHUNK 65536
+#define READER_BUF 65536
+#define WRITER_IOV 64
+#define WRITER_THRESHOLD 65536
+#define WRITER_COPY_MAX 512
+
+static void unmapFile(void *ctx, const char *data, xStrSize len)
+{
+	(void)ctx;
+	munmap((void *)data, (size_t)len + 1);
+}
+
+static const int mapAdvice[] = {
+	POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM,
+	POSIX_MADV_WILLNEED
+};
+
+// Maps len bytes of fd followed by at least one zero byte. The file can end
+// exactly on a page boundary, so room for the terminator is reserved as
+// anonymous memory first and the file is mapped over the front of it.
+static char *mapFile(int fd, size_t len)
+{
+	char *p = mmap(NULL, len + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	if (mmap(p, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		const int err = errno;
+		munmap(p, len + 1);
+		errno = err;
+		return NULL;
+	}
+	return p;
+}
+
+// Reads into whatever room is left, doubling it when under a chunk remains
+// so a file of unknown size costs a linear number of copies.
+static int readFile(xStr *str, int fd)
+{
+	for (;;) {
+		if (str->cap - str->len <= READ_CHUNK) {
+			if (str->len > XSTR_SIZE_MAX - 1 - READ_CHUNK) {
+				errno = ENOMEM;
+				return 0;
+			}
+			xStrSize want = str->len + READ_CHUNK;
+			if (str->cap < XSTR_SIZE_MAX / 2 && str->cap * 2 > want)
+				want = str->cap * 2;
+			xStrReserve(str, want);
+			if (str->cap - str->len <= READ_CHUNK) {
+				errno = ENOMEM;
+				return 0;
+			}
+		}
+		const ssize_t n = read(fd, str->str + str->len, str->cap - 1 - str->len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return 0;
+		if (n == 0)
+			return 1;
+		str->len += n;
+		str->str[str->len] = '\0';
+	}
+}
+
+// Files shorter than a read chunk cost less to read than to map. Whatever
+// is there up to the size fstat() gave is read in one buffer.
+static int readSmallFile(xStr *str, int fd, xStrSize len)
+{
+	xStrReserve(str, len + 1);
+	if (str->cap < len + 1) {
+		errno = ENOMEM;
+		return 0;
+	}
+	while (str->len < len) {
+		const ssize_t n = read(fd, str->str + str->len, len - str->len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return 0;
+		if (n == 0)
+			break;
+		str->len += n;
+	}
+	str->str[str->len] = '\0';
+	return 1;
+}
+
+int xStrMapFile(xStr *str, const char *path, xStrMapAdvice advice)
+{
+	xStrInit(str, NULL);
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	struct stat st;
+	int ok = 0;
+	if (fstat(fd, &st) != 0)
+		goto out;
+	if (!S_ISREG(st.st_mode)) {
+		ok = readFile(str, fd);
+		goto out;
+	}
+	if ((uintmax_t)st.st_size >= (uintmax_t)XSTR_SIZE_MAX) {
+		errno = EFBIG;
+		goto out;
+	}
+	const xStrSize len = st.st_size;
+	if (len < READ_CHUNK) {
+		ok = readSmallFile(str, fd, len);
+		goto out;
+	}
+	char *data = mapFile(fd, len);
+	if (!data)
+		goto out;
+	if (advice > XSTR_MAP_NORMAL && advice <= XSTR_MAP_WILLNEED)
+		posix_madvise(data, len, mapAdvice[advice]);
+	xStrCleanup(str);
+	xStrInitExternal(str, data, len, unmapFile, NULL);
+	ok = 1;
+
+out:
+	if (!ok)
+		xStrClear(str);
+	const int err = errno;
+	close(fd);
+	errno = err;
+	return ok;
+}
+
+void xStrReaderInit(xStrReader *reader, int fd)
+{
+	xStrReaderInitAlloc(reader, fd, NULL);
+}
+
+void xStrReaderInitAlloc(xStrReader *reader, int fd, const xStrAllocator *alloc)
+{
+	reader->fd = fd;
+	reader->eof = 0;
+	reader->buf = NULL;
+	reader->cap = reader->start = reader->end = 0;
+	reader->alloc = alloc ? alloc : xStrGetDefaultAllocator();
+}
+
+void xStrReaderCleanup(xStrReader *reader)
+{
+	if (reader && reader->buf)
+		reader->alloc->free(reader->alloc->ctx, reader->buf, reader->cap);
+}
+
+// Reads more input after the unread bytes, first moving them to the front
+// or growing the buffer when there is no room behind them. Returns the
+// number of bytes read, 0 at the end of input or -1 on error.
+static xStrSize readerFill(xStrReader *reader)
+{
+	if (reader->eof)
+		return 0;
+	if (reader->start == reader->end)
+		reader->start = reader->end = 0;
+	if (reader->end == reader->cap && reader->start > 0) {
+		reader->end -= reader->start;
+		memmove(reader->buf, reader->buf + reader->start, reader->end);
+		reader->start = 0;
+	} else if (reader->end == reader->cap) {
+		if (reader->cap > XSTR_SIZE_MAX / 2) {
+			errno = ENOMEM;
+			return -1;
+		}
+		const xStrSize ncap = reader->cap ? reader->cap * 2 : READER_BUF;
+		char *tmp = reader->alloc->realloc(reader->alloc->ctx, reader->buf, reader->cap, ncap);
+		if (!tmp) {
+			errno = ENOMEM;
+			return -1;
+		}
+		reader->buf = tmp;
+		reader->cap = ncap;
+	}
+	for (;;) {
+		const ssize_t n = read(reader->fd, reader->buf + reader->end, reader->cap - reader->end);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			return -1;
+		if (n == 0)
+			reader->eof = 1;
+		reader->end += n;
+		return n;
+	}
+}
+
+int xStrReaderNext(xStrReader *reader, char delim, xStrView *record)
+{
+	// bytes already searched are skipped after each refill
+	xStrSize searched = 0;
+	for (;;) {
+		const char *begin = reader->buf + reader->start;
+		const xStrSize avail = reader->end - reader->start;
+		const char *p = NULL;
+		if (avail > searched)
+			p = memchr(begin + searched, delim, avail - searched);
+		if (p) {
+			*record = xStrViewMake(begin, p - begin);
+			reader->start += (p - begin) + 1;
+			return 1;
+		}
+		searched = avail;
+		const xStrSize n = readerFill(reader);
+		if (n < 0)
+			return -1;
+		if (n == 0) {
+			if (avail == 0)
+				return 0;
+			*record = xStrViewMake(reader->buf + reader->start, avail);
+			reader->start = reader->end;
+			return 1;
+		}
+	}
+}
+
+int xStrReaderNextStr(xStrReader *reader, char delim, xStr *record)
+{
+	int found = 0;
+	xStrClear(record);
+	for (;;) {
+		const char *begin = reader->buf + reader->start;
+		const xStrSize avail = reader->end - reader->start;
+		if (avail > 0) {
+			const char *p = memchr(begin, delim, avail);
+			if (p) {
+				xStrAppendLen(record, begin, p - begin);
+				reader->start += (p - begin) + 1;
+				return 1;
+			}
+			xStrAppendLen(record, begin, avail);
+			reader->start = reader->end;
+			found = 1;
+		}
+		const xStrSize n = readerFill(reader);
+		if (n <= 0)
+			return n < 0 ? -1 : found;
+	}
+}
+
+// Pieces copied into copied are recorded with a NULL iov_base and given
+// their address only when written, since copied can move as it grows.
+struct xStrWriterBatch {
+	struct iovec iov[WRITER_IOV];
+	xStr held[WRITER_IOV];
+	xStr copied;
+	int numIov, numHeld;
+	size_t bytes;
+};
+
+struct xStrWriterAsync {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	xStrWriterBatch *pending, *spare;
+	int stop, err;
+};
+
+static xStrWriterBatch *batchNew(void)
+{
+	xStrWriterBatch *b = malloc(sizeof(*b));
+	if (b) {
+		xStrInit(&b->copied, NULL);
+		b->numIov = b->numHeld = 0;
+		b->bytes = 0;
+	}
+	return b;
+}
+
+static void batchReset(xStrWriterBatch *b)
+{
+	for (int i = 0; i < b->numHeld; i++)
+		xStrCleanup(&b->held[i]);
+	xStrClear(&b->copied);
+	b->numIov = b->numHeld = 0;
+	b->bytes = 0;
+}
+
+static void batchDelete(xStrWriterBatch *b)
+{
+	if (b) {
+		batchReset(b);
+		xStrCleanup(&b->copied);
+		free(b);
+	}
+}
+
+// Writes out and empties the batch. Returns 0 on success or an errno.
+static int batchWrite(int fd, xStrWriterBatch *b)
+{
+	struct iovec *iov = b->iov;
+	int n = b->numIov, err = 0;
+	char *copy = b->copied.str;
+	for (int i = 0; i < n; i++) {
+		if (!iov[i].iov_base) {
+			iov[i].iov_base = copy;
+			copy += iov[i].iov_len;
+		}
+	}
+	while (n > 0) {
+		ssize_t done = writev(fd, iov, n);
+		if (done < 0 && errno == EINTR)
+			continue;
+		if (done < 0) {
+			err = errno;
+			break;
+		}
+		for (; n > 0 && (size_t)done >= iov->iov_len; iov++, n--)
+			done -= iov->iov_len;
+		if (n > 0) {
+			iov->iov_base = (char *)iov->iov_base + done;
+			iov->iov_len -= done;
+		}
+	}
+	batchReset(b);
+	return err;
+}
+
+static void *writerThread(void *arg)
+{
+	xStrWriter *writer = arg;
+	xStrWriterAsync *a = writer->async;
+	pthread_mutex_lock(&a->lock);
+	for (;;) {
+		while (!a->pending && !a->stop)
+			pthread_cond_wait(&a->cond, &a->lock);
+		if (!a->pending)
+			break;
+		xStrWriterBatch *b = a->pending;
+		pthread_mutex_unlock(&a->lock);
+		const int err = batchWrite(writer->fd, b);
+		pthread_mutex_lock(&a->lock);
+		if (err && !a->err)
+			a->err = err;
+		a->spare = b;
+		a->pending = NULL;
+		pthread_cond_broadcast(&a->cond);
+	}
+	pthread_mutex_unlock(&a->lock);
+	return NULL;
+}
+
+static void writerWait(xStrWriterAsync *a)
+{
+	while (a->pending)
+		pthread_cond_wait(&a->cond, &a->lock);
+}
+
+// Writes the current batch, or hands it to the thread and carries on with
+// the other one once the thread is done with it.
+static int writerFlushBatch(xStrWriter *writer)
+{
+	xStrWriterAsync *a = writer->async;
+	if (!a) {
+		writer->err = batchWrite(writer->fd, writer->batch);
+	} else {
+		pthread_mutex_lock(&a->lock);
+		writerWait(a);
+		writer->err = a->err;
+		if (!writer->err) {
+			a->pending = writer->batch;
+			writer->batch = a->spare;
+			a->spare = NULL;
+			pthread_cond_broadcast(&a->cond);
+		}
+		pthread_mutex_unlock(&a->lock);
+	}
+	if (writer->err)
+		errno = writer->err;
+	return !writer->err;
+}
+
+void xStrWriterInit(xStrWriter *writer, int fd)
+{
+	writer->fd = fd;
+	writer->err = 0;
+	writer->threshold = WRITER_THRESHOLD;
+	writer->batch = NULL;
+	writer->async = NULL;
+}
+
+int xStrWriterInitAsync(xStrWriter *writer, int fd)
+{
+	xStrWriterInit(writer, fd);
+	xStrWriterAsync *a = malloc(sizeof(*a));
+	if (!a)
+		return 0;
+	a->pending = NULL;
+	a->stop = a->err = 0;
+	a->spare = batchNew();
+	writer->batch = batchNew();
+	if (!a->spare || !writer->batch)
+		goto fail;
+	if (pthread_mutex_init(&a->lock, NULL) != 0)
+		goto fail;
+	if (pthread_cond_init(&a->cond, NULL) != 0) {
+		pthread_mutex_destroy(&a->lock);
+		goto fail;
+	}
+	writer->async = a;
+	if (pthread_create(&a->thread, NULL, writerThread, writer) != 0) {
+		pthread_cond_destroy(&a->cond);
+		pthread_mutex_destroy(&a->lock);
+		writer->async = NULL;
+		goto fail;
+	}
+	return 1;
+
+fail:
+	batchDelete(a->spare);
+	batchDelete(writer->batch);
+	writer->batch = NULL;
+	free(a);
+	return 0;
+}
+
+void xStrWriterCleanup(xStrWriter *writer)
+{
+	if (!writer)
+		return;
+	xStrWriterAsync *a = writer->async;
+	if (a) {
+		pthread_mutex_lock(&a->lock);
+		a->stop = 1;
+		pthread_cond_broadcast(&a->cond);
+		pthread_mutex_unlock(&a->lock);
+		pthread_join(a->thread, NULL);
+		pthread_cond_destroy(&a->cond);
+		pthread_mutex_destroy(&a->lock);
+		batchDelete(a->spare);
+		free(a);
+		writer->async = NULL;
+	}
+	batchDelete(writer->batch);
+	writer->batch = NULL;
+}
+
+// Gets the batch ready for one more piece.
+static xStrWriterBatch *writerBatch(xStrWriter *writer)
+{
+	if (writer->err) {
+		errno = writer->err;
+		return NULL;
+	}
+	if (!writer->batch && !(writer->batch = batchNew())) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return writer->batch;
+}
+
+static int writerAdded(xStrWriter *writer, size_t len)
+{
+	xStrWriterBatch *b = writer->batch;
+	b->bytes += len;
+	if (b->numIov == WRITER_IOV || b->bytes >= writer->threshold)
+		return writerFlushBatch(writer);
+	return 1;
+}
+
+int xStrWriterAdd(xStrWriter *writer, xStr *str)
+{
+	if (str->len < WRITER_COPY_MAX)
+		return xStrWriterAddLen(writer, str->str, str->len);
+	xStrWriterBatch *b = writerBatch(writer);
+	if (!b)
+		return 0;
+	xStr *held = &b->held[b->numHeld++];
+	xStrInitCopy(held, str);
+	if (held->len != str->len) {
+		xStrCleanup(held);
+		b->numHeld--;
+		errno = ENOMEM;
+		return 0;
+	}
+	b->iov[b->numIov].iov_base = held->str;
+	b->iov[b->numIov].iov_len = held->len;
+	b->numIov++;
+	return writerAdded(writer, held->len);
+}
+
+int xStrWriterAddLen(xStrWriter *writer, const char *s, xStrSize len)
+{
+	if (!s)
+		return 1;
+	if (len < 0)
+		len = strlen(s);
+	if (len == 0)
+		return 1;
+	xStrWriterBatch *b = writerBatch(writer);
+	if (!b)
+		return 0;
+	const xStrSize prev = b->copied.len;
+	xStrAppendLen(&b->copied, s, len);
+	if (b->copied.len != prev + len) {
+		errno = ENOMEM;
+		return 0;
+	}
+	// runs of copied pieces go out as one
+	struct iovec *last = b->numIov ? &b->iov[b->numIov - 1] : NULL;
+	if (last && !last->iov_base) {
+		last->iov_len += len;
+	} else {
+		b->iov[b->numIov].iov_base = NULL;
+		b->iov[b->numIov].iov_len = len;
+		b->numIov++;
+	}
+	return writerAdded(writer, len);
+}
+
+int xStrWriterAddView(xStrWriter *writer, xStrView view)
+{
+	return xStrWriterAddLen(writer, view.str, view.len);
+}
+
+int xStrWriterFlush(xStrWriter *writer)
+{
+	if (writer->err) {
+		errno = writer->err;
+		return 0;
+	}
+	if (writer->batch && writer->batch->numIov > 0 && !writerFlushBatch(writer))
+		return 0;
+	xStrWriterAsync *a = writer->async;
+	if (a) {
+		pthread_mutex_lock(&a->lock);
+		writerWait(a);
+		writer->err = a->err;
+		pthread_mutex_unlock(&a->lock);
+	}
+	if (writer->err)
+		errno = writer->err;
+	return !writer->err;
+}
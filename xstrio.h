@@ -0,0 +1,73 @@
+#ifndef XSTRIO_H
+#define XSTRIO_H
+
+#include "xstr.h"
+#include <sys/uio.h>
+
+typedef enum {
+	XSTR_MAP_NORMAL,
+	XSTR_MAP_SEQUENTIAL,
+	XSTR_MAP_RANDOM,
+	XSTR_MAP_WILLNEED
+} xStrMapAdvice;
+
+// Initializes str with the contents of the file at path. Regular files of
+// 64 KiB and up are mapped read-only rather than read, with advice passed
+// on to the kernel; the mapping lasts until the last copy of str is cleaned
+// up, and changing str copies the contents out of it first. Other files are
+// read in full.
+// str is initialized either way; returns 0 with errno set and str empty on
+// failure.
+int xStrMapFile(xStr *str, const char *path, xStrMapAdvice advice) XSTR_WARN_UNUSED_RESULT;
+
+// Splits the bytes read from fd into records ending in a delimiter byte.
+// The delimiter isn't part of the record, and a last record without one is
+// still returned.
+typedef struct {
+	int fd, eof;
+	char *buf;
+	xStrSize cap, start, end;
+	const xStrAllocator *alloc;
+} xStrReader;
+
+void xStrReaderInit(xStrReader *reader, int fd);
+void xStrReaderInitAlloc(xStrReader *reader, int fd, const xStrAllocator *alloc);
+void xStrReaderCleanup(xStrReader *reader);
+
+// Both return 1 for a record, 0 at the end of input and -1 with errno set
+// on a read error. Views point into the reader's buffer and are valid until
+// the next call; the buffer grows to hold records longer than it. Records
+// assigned to an xStr reuse its capacity.
+int xStrReaderNext(xStrReader *reader, char delim, xStrView *record);
+int xStrReaderNextStr(xStrReader *reader, char delim, xStr *record);
+
+typedef struct xStrWriterBatch xStrWriterBatch;
+typedef struct xStrWriterAsync xStrWriterAsync;
+
+// Collects output for fd and writes it with writev() once enough has been
+// gathered. Strings are held by sharing their buffer, so they can be
+// changed or cleaned up as soon as they are added; short strings and raw
+// bytes are copied. Errors are sticky: once a write fails, everything else
+// fails with the same errno.
+typedef struct {
+	int fd, err;
+	size_t threshold;
+	xStrWriterBatch *batch;
+	xStrWriterAsync *async;
+} xStrWriter;
+
+void xStrWriterInit(xStrWriter *writer, int fd);
+// Writes from a background thread while the next batch is being filled.
+// Only strings from thread-safe allocators may be added, and the writer
+// must stay where it is until it is cleaned up.
+int xStrWriterInitAsync(xStrWriter *writer, int fd) XSTR_WARN_UNUSED_RESULT;
+// Drops anything not yet flushed.
+void xStrWriterCleanup(xStrWriter *writer);
+
+// These return 1 on success and 0 with errno set on failure.
+int xStrWriterAdd(xStrWriter *writer, xStr *str);
+int xStrWriterAddLen(xStrWriter *writer, const char *s, xStrSize len);
+int xStrWriterAddView(xStrWriter *writer, xStrView view);
+int xStrWriterFlush(xStrWriter *writer);
+
+#endif // XSTRIO_H
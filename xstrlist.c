@@ -0,0 +1,196 @@
+#include "xstrlist.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LIST_MIN_ITEMS 16
+#define LIST_MIN_BYTES 256
+#define BYTES(l) ((l)->offsets ? (l)->offsets[(l)->count] : 0)
+
+// Grows *p to hold at least need elements of the given size, doubling.
+static int listGrow(const xStrAllocator *alloc, void **p, xStrSize *cap,
+	xStrSize need, xStrSize min, size_t elem)
+{
+	if (need <= *cap && *p)
+		return 1;
+	xStrSize ncap = *cap ? *cap : min;
+	while (ncap < need)
+		ncap = (ncap > XSTR_SIZE_MAX / 2) ? XSTR_SIZE_MAX : ncap * 2;
+	if ((size_t)ncap > SIZE_MAX / elem)
+		return 0;
+	void *tmp = alloc->realloc(alloc->ctx, *p, *cap * elem, ncap * elem);
+	if (!tmp)
+		return 0;
+	*p = tmp;
+	*cap = ncap;
+	return 1;
+}
+
+void xStrListInit(xStrList *list)
+{
+	xStrListInitAlloc(list, NULL);
+}
+
+void xStrListInitAlloc(xStrList *list, const xStrAllocator *alloc)
+{
+	list->blob = NULL;
+	list->offsets = NULL;
+	list->count = list->offsetsCap = list->blobCap = 0;
+	list->alloc = alloc ? alloc : xStrGetDefaultAllocator();
+}
+
+void xStrListCleanup(xStrList *list)
+{
+	if (!list)
+		return;
+	if (list->blob)
+		list->alloc->free(list->alloc->ctx, list->blob, list->blobCap);
+	if (list->offsets)
+		list->alloc->free(list->alloc->ctx, list->offsets,
+			list->offsetsCap * sizeof(xStrSize));
+	list->blob = NULL;
+	list->offsets = NULL;
+	list->count = list->offsetsCap = list->blobCap = 0;
+}
+
+void xStrListClear(xStrList *list)
+{
+	list->count = 0;
+	if (list->offsets)
+		list->offsets[0] = 0;
+}
+
+int xStrListReserve(xStrList *list, xStrSize count, xStrSize bytes)
+{
+	if (count < 0 || bytes < 0 || count == XSTR_SIZE_MAX)
+		return 0;
+	if (!listGrow(list->alloc, (void **)&list->offsets, &list->offsetsCap,
+			count + 1, LIST_MIN_ITEMS, sizeof(xStrSize)))
+		return 0;
+	if (list->count == 0)
+		list->offsets[0] = 0;
+	return listGrow(list->alloc, (void **)&list->blob, &list->blobCap,
+		bytes, LIST_MIN_BYTES, 1);
+}
+
+xStrSize xStrListCount(const xStrList *list)
+{
+	return list->count;
+}
+
+xStrSize xStrListBytes(const xStrList *list)
+{
+	return BYTES(list);
+}
+
+xStrView xStrListGet(const xStrList *list, xStrSize index)
+{
+	xStrView view = { "", 0 };
+	if (index >= 0 && index < list->count) {
+		view.str = list->blob + list->offsets[index];
+		view.len = list->offsets[index + 1] - list->offsets[index];
+	}
+	return view;
+}
+
+void xStrListAppend(xStrList *list, const char *s)
+{
+	xStrListAppendView(list, xStrViewMake(s, -1));
+}
+
+void xStrListAppendLen(xStrList *list, const char *s, xStrSize len)
+{
+	xStrListAppendView(list, xStrViewMake(s, len));
+}
+
+void xStrListAppendView(xStrList *list, xStrView view)
+{
+	const xStrSize used = BYTES(list);
+	if (view.len > XSTR_SIZE_MAX - used || list->count == XSTR_SIZE_MAX - 1)
+		return;
+	if (!xStrListReserve(list, list->count + 1, used + view.len))
+		return;
+	memcpy(list->blob + used, view.str, view.len);
+	list->offsets[++list->count] = used + view.len;
+}
+
+static int listCompare(const void *a, const void *b)
+{
+	return xStrViewCompare(*(const xStrView *)a, *(const xStrView *)b);
+}
+
+// Sorts views of the items, then packs them into a new blob in order, so
+// neighbours in the list are neighbours in memory again.
+void xStrListSort(xStrList *list)
+{
+	const xStrSize count = list->count, bytes = BYTES(list);
+	if (count < 2 || (size_t)count > SIZE_MAX / sizeof(xStrView))
+		return;
+	const xStrAllocator *alloc = list->alloc;
+	xStrView *views = alloc->alloc(alloc->ctx, count * sizeof(xStrView));
+	char *blob = alloc->alloc(alloc->ctx, bytes ? bytes : 1);
+	if (!views || !blob) {
+		if (views)
+			alloc->free(alloc->ctx, views, count * sizeof(xStrView));
+		if (blob)
+			alloc->free(alloc->ctx, blob, bytes ? bytes : 1);
+		return;
+	}
+	for (xStrSize i = 0; i < count; i++)
+		views[i] = xStrListGet(list, i);
+	qsort(views, count, sizeof(xStrView), listCompare);
+
+	xStrSize off = 0;
+	for (xStrSize i = 0; i < count; i++) {
+		memcpy(blob + off, views[i].str, views[i].len);
+		off += views[i].len;
+		list->offsets[i + 1] = off;
+	}
+	alloc->free(alloc->ctx, views, count * sizeof(xStrView));
+	alloc->free(alloc->ctx, list->blob, list->blobCap);
+	list->blob = blob;
+	list->blobCap = bytes ? bytes : 1;
+}
+
+// Drops items equal to the one before them, compacting the blob in place.
+void xStrListDedup(xStrList *list)
+{
+	if (list->count < 2)
+		return;
+	xStrSize kept = 1, off = list->offsets[1];
+	for (xStrSize i = 1; i < list->count; i++) {
+		const xStrView cur = xStrListGet(list, i);
+		const xStrView prev = {
+			list->blob + list->offsets[kept - 1],
+			off - list->offsets[kept - 1]
+		};
+		if (xStrViewEqual(cur, prev))
+			continue;
+		memmove(list->blob + off, cur.str, cur.len);
+		off += cur.len;
+		list->offsets[++kept] = off;
+	}
+	list->count = kept;
+}
+
+void xStrListFromStrs(xStrList *list, const xStr *strs, xStrSize count)
+{
+	xStrSize bytes = BYTES(list);
+	for (xStrSize i = 0; i < count; i++) {
+		if (strs[i].len > XSTR_SIZE_MAX - bytes)
+			return;
+		bytes += strs[i].len;
+	}
+	if (count > XSTR_SIZE_MAX - 1 - list->count
+		|| !xStrListReserve(list, list->count + count, bytes))
+		return;
+	for (xStrSize i = 0; i < count; i++)
+		xStrListAppendView(list, xStrViewOf(&strs[i]));
+}
+
+void xStrListToStrs(const xStrList *list, xStr *strs)
+{
+	for (xStrSize i = 0; i < list->count; i++) {
+		const xStrView view = xStrListGet(list, i);
+		xStrInitLenAlloc(&strs[i], view.str, view.len, list->alloc);
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef XSTRLIST_H
+#define XSTRLIST_H
+
+#include "xstr.h"
+
+// A list of byte strings packed back to back in one blob, with item i
+// spanning offsets[i] to offsets[i + 1]. Views returned by xStrListGet()
+// point into the blob and are invalidated by any change to the list.
+typedef struct {
+	char *blob;
+	xStrSize *offsets;
+	xStrSize count, offsetsCap, blobCap;
+	const xStrAllocator *alloc;
+} xStrList;
+
+void xStrListInit(xStrList *list);
+void xStrListInitAlloc(xStrList *list, const xStrAllocator *alloc);
+void xStrListCleanup(xStrList *list);
+void xStrListClear(xStrList *list);
+int xStrListReserve(xStrList *list, xStrSize count, xStrSize bytes) XSTR_WARN_UNUSED_RESULT;
+
+xStrSize xStrListCount(const xStrList *list);
+xStrSize xStrListBytes(const xStrList *list);
+xStrView xStrListGet(const xStrList *list, xStrSize index);
+
+void xStrListAppend(xStrList *list, const char *s);
+void xStrListAppendLen(xStrList *list, const char *s, xStrSize len);
+void xStrListAppendView(xStrList *list, xStrView view);
+
+void xStrListSort(xStrList *list);
+void xStrListDedup(xStrList *list);
+
+void xStrListFromStrs(xStrList *list, const xStr *strs, xStrSize count);
+void xStrListToStrs(const xStrList *list, xStr *strs);
+
+#endif // XSTRLIST_H
@@ -0,0 +1,215 @@
+#include "xstrmap.h"
+#include <string.h>
+
+#define MAP_MIN_CAP 16
+#define MAP_KEY_BLOCK 4096
+
+static int mapKeyEqual(const xStrMapEntry *e, uint64_t hash, xStrView key)
+{
+	return e->hash == hash && e->keyLen == key.len
+		&& (key.len == 0 || memcmp(e->key, key.str, key.len) == 0);
+}
+
+static xStrMapEntry *mapFind(const xStrMap *map, uint64_t hash, xStrView key)
+{
+	if (!map->entries)
+		return NULL;
+	const xStrSize mask = map->cap - 1;
+	for (xStrSize i = hash & mask;; i = (i + 1) & mask) {
+		xStrMapEntry *e = &map->entries[i];
+		if (!e->key)
+			return NULL;
+		if (mapKeyEqual(e, hash, key))
+			return e;
+	}
+}
+
+// Resizes the table to ncap slots (a power of two) and reinserts everything
+// by stored hash, so no keys are compared.
+static int mapRehash(xStrMap *map, xStrSize ncap)
+{
+	if ((size_t)ncap > SIZE_MAX / sizeof(xStrMapEntry))
+		return 0;
+	const size_t size = ncap * sizeof(xStrMapEntry);
+	xStrMapEntry *entries = map->alloc->alloc(map->alloc->ctx, size);
+	if (!entries)
+		return 0;
+	memset(entries, 0, size);
+	const xStrSize mask = ncap - 1;
+	for (xStrSize i = 0; i < map->cap; i++) {
+		const xStrMapEntry *e = &map->entries[i];
+		if (!e->key)
+			continue;
+		xStrSize j = e->hash & mask;
+		while (entries[j].key)
+			j = (j + 1) & mask;
+		entries[j] = *e;
+	}
+	if (map->entries)
+		map->alloc->free(map->alloc->ctx, map->entries,
+			map->cap * sizeof(xStrMapEntry));
+	map->entries = entries;
+	map->cap = ncap;
+	return 1;
+}
+
+// Copies the live keys into a fresh arena and drops the old one with all
+// the removed keys still in it.
+static int mapCompactKeys(xStrMap *map)
+{
+	xStrArena keys;
+	xStrArenaInitAlloc(&keys, MAP_KEY_BLOCK, map->alloc);
+	for (xStrSize i = 0; i < map->cap; i++) {
+		xStrMapEntry *e = &map->entries[i];
+		if (!e->key)
+			continue;
+		char *copy = xStrArenaAlloc(&keys, (size_t)e->keyLen + 1);
+		if (!copy) {
+			xStrArenaCleanup(&keys);
+			return 0;
+		}
+		memcpy(copy, e->key, (size_t)e->keyLen + 1);
+		e->key = copy;
+	}
+	xStrArenaCleanup(&map->keys);
+	map->keys = keys;
+	map->deadBytes = 0;
+	return 1;
+}
+
+void xStrMapInit(xStrMap *map)
+{
+	xStrMapInitAlloc(map, NULL);
+}
+
+void xStrMapInitAlloc(xStrMap *map, const xStrAllocator *alloc)
+{
+	map->entries = NULL;
+	map->cap = map->count = 0;
+	map->alloc = alloc ? alloc : xStrGetDefaultAllocator();
+	map->liveBytes = map->deadBytes = 0;
+	map->seed = xStrHashSeed();
+	xStrArenaInitAlloc(&map->keys, MAP_KEY_BLOCK, map->alloc);
+}
+
+void xStrMapCleanup(xStrMap *map)
+{
+	if (!map)
+		return;
+	if (map->entries)
+		map->alloc->free(map->alloc->ctx, map->entries,
+			map->cap * sizeof(xStrMapEntry));
+	map->entries = NULL;
+	map->cap = map->count = 0;
+	map->liveBytes = map->deadBytes = 0;
+	xStrArenaCleanup(&map->keys);
+}
+
+void xStrMapClear(xStrMap *map)
+{
+	if (map->entries)
+		memset(map->entries, 0, map->cap * sizeof(xStrMapEntry));
+	map->count = 0;
+	map->liveBytes = map->deadBytes = 0;
+	xStrArenaReset(&map->keys);
+}
+
+xStrSize xStrMapCount(const xStrMap *map)
+{
+	return map->count;
+}
+
+xStrMapEntry *xStrMapLookup(const xStrMap *map, xStrView key)
+{
+	if (key.len < 0 || (!key.str && key.len > 0))
+		return NULL;
+	return mapFind(map, xStrHashLen(key.str, key.len, map->seed), key);
+}
+
+void *xStrMapGet(const xStrMap *map, xStrView key)
+{
+	xStrMapEntry *e = xStrMapLookup(map, key);
+	return e ? e->value : NULL;
+}
+
+int xStrMapSet(xStrMap *map, xStrView key, void *value)
+{
+	if (key.len < 0 || (!key.str && key.len > 0))
+		return 0;
+	const uint64_t hash = xStrHashLen(key.str, key.len, map->seed);
+	xStrMapEntry *e = mapFind(map, hash, key);
+	if (e) {
+		e->value = value;
+		return 1;
+	}
+
+	// keep the load factor at or below 3/4
+	if (map->count >= map->cap - map->cap / 4) {
+		if (map->cap > XSTR_SIZE_MAX / 2)
+			return 0;
+		if (!mapRehash(map, map->cap ? map->cap * 2 : MAP_MIN_CAP))
+			return 0;
+	}
+	// once removed keys outweigh the live ones, copying the live ones out
+	// costs no more than the removals that made the garbage
+	if (map->deadBytes > map->liveBytes + MAP_KEY_BLOCK && !mapCompactKeys(map))
+		return 0;
+	char *copy = xStrArenaAlloc(&map->keys, (size_t)key.len + 1);
+	if (!copy)
+		return 0;
+	memcpy(copy, key.str, key.len);
+	copy[key.len] = '\0';
+
+	const xStrSize mask = map->cap - 1;
+	xStrSize i = hash & mask;
+	while (map->entries[i].key)
+		i = (i + 1) & mask;
+	e = &map->entries[i];
+	e->hash = hash;
+	e->key = copy;
+	e->keyLen = key.len;
+	e->value = value;
+	map->count++;
+	map->liveBytes += (size_t)key.len + 1;
+	return 1;
+}
+
+int xStrMapRemove(xStrMap *map, xStrView key)
+{
+	xStrMapEntry *e = xStrMapLookup(map, key);
+	if (!e)
+		return 0;
+	map->liveBytes -= (size_t)e->keyLen + 1;
+	map->deadBytes += (size_t)e->keyLen + 1;
+
+	// shift later entries of the cluster back into the hole instead of
+	// leaving a tombstone, skipping those whose home slot is past the hole
+	const xStrSize mask = map->cap - 1;
+	xStrSize i = e - map->entries, j = i;
+	for (;;) {
+		j = (j + 1) & mask;
+		const xStrMapEntry *next = &map->entries[j];
+		if (!next->key)
+			break;
+		const xStrSize home = next->hash & mask;
+		if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		map->entries[i] = *next;
+		i = j;
+	}
+	map->entries[i].key = NULL;
+	map->count--;
+	return 1;
+}
+
+xStrMapEntry *xStrMapNext(const xStrMap *map, xStrSize *pos)
+{
+	for (xStrSize i = *pos; i < map->cap; i++) {
+		if (map->entries[i].key) {
+			*pos = i + 1;
+			return &map->entries[i];
+		}
+	}
+	*pos = map->cap;
+	return NULL;
+}
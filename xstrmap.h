@@ -0,0 +1,42 @@
+#ifndef XSTRMAP_H
+#define XSTRMAP_H
+
+#include "xstr.h"
+
+// An empty slot has a NULL key. Keys are NUL-terminated copies owned by the
+// map; like the entries themselves they may move on any xStrMapSet().
+typedef struct {
+	uint64_t hash;
+	const char *key;
+	xStrSize keyLen;
+	void *value;
+} xStrMapEntry;
+
+// Open-addressing table with linear probing, keyed by byte strings. Lookups
+// compare the stored hash and length before touching the key bytes. Each map
+// hashes with its own random seed, and the bytes of removed keys are
+// reclaimed once they outweigh the live ones. Entries and keys both come
+// from the map's allocator and nothing points back into the xStrMap, so it
+// may be moved between calls.
+typedef struct {
+	xStrMapEntry *entries;
+	xStrSize cap, count;
+	const xStrAllocator *alloc;
+	xStrArena keys;
+	size_t liveBytes, deadBytes;
+	uint64_t seed;
+} xStrMap;
+
+void xStrMapInit(xStrMap *map);
+void xStrMapInitAlloc(xStrMap *map, const xStrAllocator *alloc);
+void xStrMapCleanup(xStrMap *map);
+void xStrMapClear(xStrMap *map);
+xStrSize xStrMapCount(const xStrMap *map);
+
+xStrMapEntry *xStrMapLookup(const xStrMap *map, xStrView key);
+void *xStrMapGet(const xStrMap *map, xStrView key);
+int xStrMapSet(xStrMap *map, xStrView key, void *value);
+int xStrMapRemove(xStrMap *map, xStrView key);
+xStrMapEntry *xStrMapNext(const xStrMap *map, xStrSize *pos);
+
+#endif // XSTRMAP_H
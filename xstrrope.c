@@ -0,0 +1,421 @@
+#include "xstrrope.h"
+#include <string.h>
+
+#define ROPE_CHUNK 4000
+#define ROPE_HALF (ROPE_CHUNK / 2)
+#define TOTAL(t) ((t) ? (t)->total : 0)
+#define COUNT(t) ((t) ? (t)->count : 0)
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+struct xStrRopeNode {
+	xStrRopeNode *left, *right;
+	unsigned int prio;
+	xStrSize len, total, count;
+	char data[ROPE_CHUNK];
+};
+
+static unsigned int ropeRandom(xStrRope *rope)
+{
+	unsigned int x = rope->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (rope->seed = x);
+}
+
+static void ropeUpdate(xStrRopeNode *t)
+{
+	t->total = t->len + TOTAL(t->left) + TOTAL(t->right);
+	t->count = 1 + COUNT(t->left) + COUNT(t->right);
+}
+
+static xStrRopeNode *ropeNewNode(xStrRope *rope, const char *s, xStrSize len)
+{
+	xStrRopeNode *t = rope->alloc->alloc(rope->alloc->ctx, sizeof(xStrRopeNode));
+	if (!t)
+		return NULL;
+	t->left = t->right = NULL;
+	t->prio = ropeRandom(rope);
+	t->len = len;
+	memcpy(t->data, s, len);
+	ropeUpdate(t);
+	return t;
+}
+
+static void ropeFreeNode(xStrRope *rope, xStrRopeNode *t)
+{
+	if (t)
+		rope->alloc->free(rope->alloc->ctx, t, sizeof(xStrRopeNode));
+}
+
+static void ropeFreeTree(xStrRope *rope, xStrRopeNode *t)
+{
+	if (t) {
+		ropeFreeTree(rope, t->left);
+		ropeFreeTree(rope, t->right);
+		ropeFreeNode(rope, t);
+	}
+}
+
+static xStrRopeNode *ropeMerge(xStrRopeNode *a, xStrRopeNode *b)
+{
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+	if (a->prio > b->prio) {
+		a->right = ropeMerge(a->right, b);
+		ropeUpdate(a);
+		return a;
+	}
+	b->left = ropeMerge(a, b->left);
+	ropeUpdate(b);
+	return b;
+}
+
+// Splits t so that *l holds the first pos bytes. A chunk straddling pos is
+// cut in two, with *spare receiving the second half.
+static void ropeSplit(xStrRopeNode *t, xStrSize pos, xStrRopeNode **l,
+	xStrRopeNode **r, xStrRopeNode **spare)
+{
+	if (!t) {
+		*l = *r = NULL;
+		return;
+	}
+	const xStrSize leftTotal = TOTAL(t->left);
+	if (pos <= leftTotal) {
+		ropeSplit(t->left, pos, l, &t->left, spare);
+		ropeUpdate(t);
+		*r = t;
+	} else if (pos >= leftTotal + t->len) {
+		ropeSplit(t->right, pos - leftTotal - t->len, &t->right, r, spare);
+		ropeUpdate(t);
+		*l = t;
+	} else {
+		const xStrSize off = pos - leftTotal;
+		xStrRopeNode *tail = *spare;
+		*spare = NULL;
+		tail->left = tail->right = NULL;
+		tail->len = t->len - off;
+		memcpy(tail->data, t->data + off, tail->len);
+		ropeUpdate(tail);
+		t->len = off;
+		*r = ropeMerge(tail, t->right);
+		t->right = NULL;
+		ropeUpdate(t);
+		*l = t;
+	}
+}
+
+// Detach the first or last chunk of *t.
+static xStrRopeNode *ropeTakeFirst(xStrRopeNode **t)
+{
+	xStrRopeNode *n = *t;
+	if (!n)
+		return NULL;
+	if (n->left) {
+		xStrRopeNode *first = ropeTakeFirst(&n->left);
+		ropeUpdate(n);
+		return first;
+	}
+	*t = n->right;
+	n->right = NULL;
+	ropeUpdate(n);
+	return n;
+}
+
+static xStrRopeNode *ropeTakeLast(xStrRopeNode **t)
+{
+	xStrRopeNode *n = *t;
+	if (!n)
+		return NULL;
+	if (n->right) {
+		xStrRopeNode *last = ropeTakeLast(&n->right);
+		ropeUpdate(n);
+		return last;
+	}
+	*t = n->left;
+	n->left = NULL;
+	ropeUpdate(n);
+	return n;
+}
+
+// Joins l and r, keeping every chunk but the last of the rope at least half
+// full. Chunks away from the seam already are, so only the two on either
+// side of it are looked at; if one falls short, their bytes are packed into
+// as few chunks as hold them, with the last two evened out when the final
+// one would still be short and isn't the end of the rope.
+static xStrRopeNode *ropeJoin(xStrRope *rope, xStrRopeNode *l, xStrRopeNode *r)
+{
+	xStrRopeNode *n[4];
+	int count = 0;
+	xStrRopeNode *a = ropeTakeLast(&l), *p = ropeTakeLast(&l);
+	xStrRopeNode *b = ropeTakeFirst(&r), *q = ropeTakeFirst(&r);
+	if (p)
+		n[count++] = p;
+	if (a)
+		n[count++] = a;
+	if (b)
+		n[count++] = b;
+	if (q)
+		n[count++] = q;
+
+	int ok = 1;
+	for (int i = 0; i < count; i++) {
+		if (n[i]->len < ROPE_HALF && (i < count - 1 || r))
+			ok = 0;
+	}
+	if (!ok) {
+		char buf[4 * ROPE_CHUNK];
+		xStrSize total = 0;
+		for (int i = 0; i < count; i++) {
+			memcpy(buf + total, n[i]->data, n[i]->len);
+			total += n[i]->len;
+		}
+		const int used = (total + ROPE_CHUNK - 1) / ROPE_CHUNK;
+		xStrSize off = 0;
+		for (int i = 0; i < used; i++) {
+			xStrSize len = MIN(ROPE_CHUNK, total - off);
+			if (i == used - 2 && total - off - len < ROPE_HALF && r)
+				len = (total - off + 1) / 2;
+			memcpy(n[i]->data, buf + off, len);
+			n[i]->len = len;
+			ropeUpdate(n[i]);
+			off += len;
+		}
+		for (int i = used; i < count; i++)
+			ropeFreeNode(rope, n[i]);
+		count = used;
+	}
+	for (int i = 0; i < count; i++)
+		l = ropeMerge(l, n[i]);
+	return ropeMerge(l, r);
+}
+
+// Inserts into the chunk holding pos if it has room, fixing up the totals
+// on the way back. Returns 0 without changes when the chunk is full.
+static int ropeInsertInPlace(xStrRopeNode *t, xStrSize pos, const char *s,
+	xStrSize len)
+{
+	if (!t)
+		return 0;
+	const xStrSize leftTotal = TOTAL(t->left);
+	int ok;
+	if (pos <= leftTotal && t->left) {
+		ok = ropeInsertInPlace(t->left, pos, s, len);
+	} else if (pos <= leftTotal + t->len) {
+		const xStrSize off = pos - leftTotal;
+		if (len > ROPE_CHUNK - t->len)
+			return 0;
+		memmove(t->data + off + len, t->data + off, t->len - off);
+		memcpy(t->data + off, s, len);
+		t->len += len;
+		ok = 1;
+	} else {
+		ok = ropeInsertInPlace(t->right, pos - leftTotal - t->len, s, len);
+	}
+	if (ok)
+		t->total += len;
+	return ok;
+}
+
+// Erases a range lying inside a single chunk if that leaves at least min
+// bytes in it.
+static int ropeEraseInPlace(xStrRopeNode *t, xStrSize pos, xStrSize len,
+	xStrSize min)
+{
+	if (!t)
+		return 0;
+	const xStrSize leftTotal = TOTAL(t->left);
+	int ok;
+	if (pos < leftTotal) {
+		ok = ropeEraseInPlace(t->left, pos, len, min);
+	} else if (pos < leftTotal + t->len) {
+		const xStrSize off = pos - leftTotal;
+		if (t->len - len < min || off > t->len - len)
+			return 0;
+		memmove(t->data + off, t->data + off + len, t->len - off - len);
+		t->len -= len;
+		ok = 1;
+	} else {
+		ok = ropeEraseInPlace(t->right, pos - leftTotal - t->len, len, min);
+	}
+	if (ok)
+		t->total -= len;
+	return ok;
+}
+
+void xStrRopeInit(xStrRope *rope)
+{
+	xStrRopeInitAlloc(rope, NULL);
+}
+
+void xStrRopeInitAlloc(xStrRope *rope, const xStrAllocator *alloc)
+{
+	rope->root = NULL;
+	rope->alloc = alloc ? alloc : xStrGetDefaultAllocator();
+	rope->seed = 2463534242u;
+}
+
+void xStrRopeCleanup(xStrRope *rope)
+{
+	if (rope)
+		xStrRopeClear(rope);
+}
+
+void xStrRopeClear(xStrRope *rope)
+{
+	ropeFreeTree(rope, rope->root);
+	rope->root = NULL;
+}
+
+xStrSize xStrRopeLength(const xStrRope *rope)
+{
+	return TOTAL(rope->root);
+}
+
+xStrSize xStrRopeSegments(const xStrRope *rope)
+{
+	return COUNT(rope->root);
+}
+
+char xStrRopeCharAt(const xStrRope *rope, xStrSize pos)
+{
+	const xStrRopeNode *t = rope->root;
+	if (pos < 0 || pos >= TOTAL(t))
+		return '\0';
+	while (t) {
+		const xStrSize leftTotal = TOTAL(t->left);
+		if (pos < leftTotal) {
+			t = t->left;
+		} else if (pos < leftTotal + t->len) {
+			return t->data[pos - leftTotal];
+		} else {
+			pos -= leftTotal + t->len;
+			t = t->right;
+		}
+	}
+	return '\0';
+}
+
+void xStrRopeInsert(xStrRope *rope, xStrSize pos, const char *s)
+{
+	xStrRopeInsertLen(rope, pos, s, -1);
+}
+
+void xStrRopeInsertLen(xStrRope *rope, xStrSize pos, const char *s,
+	xStrSize len)
+{
+	if (!s || pos < 0 || pos > TOTAL(rope->root))
+		return;
+	if (len < 0) {
+		size_t slen = strlen(s);
+		if (slen > (size_t)XSTR_SIZE_MAX)
+			return;
+		len = slen;
+	}
+	if (len == 0 || len > XSTR_SIZE_MAX - TOTAL(rope->root))
+		return;
+	if (len <= ROPE_CHUNK && ropeInsertInPlace(rope->root, pos, s, len))
+		return;
+
+	// build the new chunks first so running out of memory changes nothing
+	xStrRopeNode *spare = ropeNewNode(rope, s, 0);
+	xStrRopeNode *mid = NULL;
+	if (!spare)
+		return;
+	for (xStrSize off = 0; off < len; off += ROPE_CHUNK) {
+		xStrRopeNode *t = ropeNewNode(rope, s + off, MIN(ROPE_CHUNK, len - off));
+		if (!t) {
+			ropeFreeTree(rope, mid);
+			ropeFreeNode(rope, spare);
+			return;
+		}
+		mid = ropeMerge(mid, t);
+	}
+
+	xStrRopeNode *l, *r;
+	ropeSplit(rope->root, pos, &l, &r, &spare);
+	rope->root = ropeJoin(rope, ropeJoin(rope, l, mid), r);
+	ropeFreeNode(rope, spare);
+}
+
+void xStrRopeAppend(xStrRope *rope, const char *s)
+{
+	xStrRopeInsertLen(rope, TOTAL(rope->root), s, -1);
+}
+
+void xStrRopeAppendLen(xStrRope *rope, const char *s, xStrSize len)
+{
+	xStrRopeInsertLen(rope, TOTAL(rope->root), s, len);
+}
+
+void xStrRopeErase(xStrRope *rope, xStrSize pos, xStrSize len)
+{
+	const xStrSize total = TOTAL(rope->root);
+	if (pos < 0 || pos >= total || len == 0 || len < -1)
+		return;
+	if (len == -1 || len > total - pos)
+		len = total - pos;
+	// a lone chunk may shrink to anything, others stay half full
+	const xStrSize min = (COUNT(rope->root) == 1) ? 1 : ROPE_HALF;
+	if (ropeEraseInPlace(rope->root, pos, len, min))
+		return;
+
+	xStrRopeNode *spare1 = ropeNewNode(rope, "", 0);
+	xStrRopeNode *spare2 = ropeNewNode(rope, "", 0);
+	if (spare1 && spare2) {
+		xStrRopeNode *l, *m, *r;
+		ropeSplit(rope->root, pos, &l, &r, &spare1);
+		ropeSplit(r, len, &m, &r, &spare2);
+		ropeFreeTree(rope, m);
+		rope->root = ropeJoin(rope, l, r);
+	}
+	ropeFreeNode(rope, spare1);
+	ropeFreeNode(rope, spare2);
+}
+
+static void ropeFlatten(const xStrRopeNode *t, xStr *str)
+{
+	if (t) {
+		ropeFlatten(t->left, str);
+		xStrAppendLen(str, t->data, t->len);
+		ropeFlatten(t->right, str);
+	}
+}
+
+void xStrRopeFlatten(const xStrRope *rope, xStr *str)
+{
+	xStrClear(str);
+	xStrReserve(str, TOTAL(rope->root));
+	ropeFlatten(rope->root, str);
+}
+
+static xStrSize ropeIovec(const xStrRopeNode *t, xStrSize first,
+	struct iovec *iov, xStrSize maxIov)
+{
+	if (!t || maxIov <= 0)
+		return 0;
+	const xStrSize leftCount = COUNT(t->left);
+	xStrSize n = 0;
+	if (first < leftCount)
+		n = ropeIovec(t->left, first, iov, maxIov);
+	if (first <= leftCount && n < maxIov) {
+		iov[n].iov_base = (void *)t->data;
+		iov[n].iov_len = t->len;
+		n++;
+	}
+	if (n < maxIov) {
+		const xStrSize skip = (first > leftCount) ? first - leftCount - 1 : 0;
+		n += ropeIovec(t->right, skip, iov + n, maxIov - n);
+	}
+	return n;
+}
+
+xStrSize xStrRopeToIovec(const xStrRope *rope, xStrSize first,
+	struct iovec *iov, xStrSize maxIov)
+{
+	if (first < 0)
+		first = 0;
+	return ropeIovec(rope->root, first, iov, maxIov);
+}
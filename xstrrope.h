@@ -0,0 +1,36 @@
+#ifndef XSTRROPE_H
+#define XSTRROPE_H
+
+#include "xstr.h"
+#include <sys/uio.h>
+
+typedef struct xStrRopeNode xStrRopeNode;
+
+// Text kept as a treap of fixed-size chunks ordered by position, so inserts
+// and erases anywhere cost O(log n) plus a few chunks of copying. Every
+// chunk but the last is kept at least half full.
+typedef struct {
+	xStrRopeNode *root;
+	const xStrAllocator *alloc;
+	unsigned int seed;
+} xStrRope;
+
+void xStrRopeInit(xStrRope *rope);
+void xStrRopeInitAlloc(xStrRope *rope, const xStrAllocator *alloc);
+void xStrRopeCleanup(xStrRope *rope);
+void xStrRopeClear(xStrRope *rope);
+
+xStrSize xStrRopeLength(const xStrRope *rope);
+xStrSize xStrRopeSegments(const xStrRope *rope);
+char xStrRopeCharAt(const xStrRope *rope, xStrSize pos);
+
+void xStrRopeInsert(xStrRope *rope, xStrSize pos, const char *s);
+void xStrRopeInsertLen(xStrRope *rope, xStrSize pos, const char *s, xStrSize len);
+void xStrRopeAppend(xStrRope *rope, const char *s);
+void xStrRopeAppendLen(xStrRope *rope, const char *s, xStrSize len);
+void xStrRopeErase(xStrRope *rope, xStrSize pos, xStrSize len);
+
+void xStrRopeFlatten(const xStrRope *rope, xStr *str);
+xStrSize xStrRopeToIovec(const xStrRope *rope, xStrSize first, struct iovec *iov, xStrSize maxIov);
+
+#endif // XSTRROPE_H